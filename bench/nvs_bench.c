@@ -0,0 +1,406 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "tinynvs.h"
+#include "hal_flash.h"
+#include "hal_flash_cache.h"
+
+#define BENCH_KEYS      16
+#define BENCH_READS     20000
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Mock 时序模型的虚拟时钟 (不受主机磁盘 I/O 影响)
+static double sim_us(void) {
+    return hal_flash_now_ns() / 1e3;
+}
+
+// NVS 和 Mock 的日志很多，跑负载时先把 stdout 关掉，只打印结果
+static int saved_stdout = -1;
+
+static void quiet_begin(void) {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+}
+
+static void quiet_end(void) {
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
+static void make_key(char *key, int i) {
+    sprintf(key, "bench_param_%02d", i);
+}
+
+static void bench_prepare(void) {
+    char key[32];
+    uint8_t val[32];
+
+    for (int i = 0; i < BENCH_KEYS; i++) {
+        make_key(key, i);
+        memset(val, i, sizeof(val));
+        nvs_set(key, val, sizeof(val));
+    }
+}
+
+// --- 读取延迟: 对比三种完整性校验策略 ---
+static void bench_verify_policy(void) {
+    static const struct {
+        nvs_verify_policy_t policy;
+        const char *name;
+    } modes[] = {
+        { NVS_VERIFY_ALWAYS,   "always"   },
+        { NVS_VERIFY_SAMPLED,  "sampled"  },
+        { NVS_VERIFY_ON_MOUNT, "on-mount" },
+    };
+
+    char key[32];
+    uint8_t buf[64];
+
+    printf("\n--- Read latency by verify policy (%d keys, %d reads) ---\n", BENCH_KEYS, BENCH_READS);
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        nvs_set_verify_policy(modes[m].policy);
+
+        double start = sim_us();
+        for (int i = 0; i < BENCH_READS; i++) {
+            make_key(key, i % BENCH_KEYS);
+            nvs_get(key, buf, sizeof(buf));
+        }
+        double elapsed = sim_us() - start;
+
+        printf("  %-10s %8.3f sim us/read\n", modes[m].name, elapsed / BENCH_READS);
+    }
+
+    // 巡检: 一次完整扫描的开销，可以按预算拆到空闲时间里做
+    double start = sim_us();
+    nvs_scrub(NVS_SECTOR_SIZE);
+    printf("  scrub      %8.3f sim us/full pass\n", sim_us() - start);
+
+    nvs_set_verify_policy(NVS_VERIFY_ALWAYS);
+}
+
+// --- Key 句柄: 按名字查找 (strlen + CRC32) vs 预先算好哈希的句柄 ---
+static void bench_key_handle(void) {
+    static char names[BENCH_KEYS][32];
+    static nvs_key_t handles[BENCH_KEYS];
+    uint8_t buf[64];
+
+    for (int i = 0; i < BENCH_KEYS; i++) {
+        make_key(names[i], i);
+        nvs_key_init(&handles[i], names[i]);
+    }
+
+    // 信任 RAM 索引，读取开销里只剩查找本身
+    nvs_set_verify_policy(NVS_VERIFY_ON_MOUNT);
+    printf("\n--- Key lookup cost (%d reads, on-mount verify) ---\n", BENCH_READS);
+
+    double start = now_us();
+    for (int i = 0; i < BENCH_READS; i++) {
+        nvs_get(names[i % BENCH_KEYS], buf, sizeof(buf));
+    }
+    printf("  by name    %8.3f us/read\n", (now_us() - start) / BENCH_READS);
+
+    start = now_us();
+    for (int i = 0; i < BENCH_READS; i++) {
+        nvs_get_by_handle(&handles[i % BENCH_KEYS], buf, sizeof(buf));
+    }
+    printf("  by handle  %8.3f us/read\n", (now_us() - start) / BENCH_READS);
+
+    nvs_set_verify_policy(NVS_VERIFY_ALWAYS);
+}
+
+// --- 磨损均衡: 热 Key + 长时间不动的冷数据 + 频繁重启的负载下，各扇区擦除次数的分布 ---
+#define WL_CYCLES           40
+
+static uint32_t wear_base[NVS_SECTOR_COUNT];
+
+static void wear_reset(const uint32_t *preset) {
+    // preset 给每个扇区预先带上的磨损 (模拟上一阶段的负载)，NULL 表示全部从 0 开始
+    // 没有 USED 扇区，nvs_init 总是从扇区 0 开始写
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        hal_flash_erase(nvs_sector_addr(i));
+        if (preset && preset[i]) {
+            nvs_sector_header_t header = { NVS_SECTOR_MAGIC(g_nvs.device_count), preset[i], SECTOR_STATE_EMPTY, NVS_FREE_SEQ_ID };
+            hal_flash_write(nvs_sector_addr(i), &header, sizeof(header));
+        }
+    }
+    // 真实磨损 = 预置的次数 + 之后 Mock 里实际发生的擦除
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        wear_base[i] = (preset ? preset[i] : 0) - hal_flash_get_erase_count(nvs_sector_addr(i));
+    }
+    memset(g_nvs.sector_erase_counts, 0, sizeof(g_nvs.sector_erase_counts));
+    nvs_init();
+    bench_prepare();
+}
+
+// hot_writes: 每个周期热 Key 的写入次数；idle_checks: 每个周期的空闲检查次数
+static void bench_wear_case(const char *name, int devices, const uint32_t *preset, int hot_writes, int idle_checks,
+                            int lose_counts, int static_wl) {
+    quiet_begin();
+    hal_flash_init();
+    if (devices > 1) {
+        remove("flash_mock_1.bin");
+        hal_flash_add_device("flash_mock_1.bin");
+    }
+    nvs_init();
+    nvs_set_static_wl(static_wl);
+    wear_reset(preset);
+    nvs_reset_stats();
+
+    for (int cycle = 0; cycle < WL_CYCLES; cycle++) {
+        for (int i = 0; i < hot_writes; i++) {
+            uint32_t v = cycle * hot_writes + i;
+            nvs_set("hot_counter", &v, sizeof(v));
+        }
+
+        for (int i = 0; i < idle_checks; i++) {
+            nvs_static_wl_step(NVS_SECTOR_SIZE);
+            nvs_poll(cycle * 1000 + i);
+        }
+
+        // 旧固件不保存空闲扇区的擦除次数: 重启前把空闲头部的 magic 清零来模拟
+        // (只把 bit 从 1 写成 0，不产生额外的擦除)
+        if (lose_counts) {
+            uint32_t zero = 0;
+            for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+                if (nvs_sector_addr(i) != g_nvs.active_sector_addr) hal_flash_write(nvs_sector_addr(i), &zero, sizeof(zero));
+            }
+        }
+        nvs_init();
+    }
+
+    nvs_stats_t stats;
+    nvs_get_stats(&stats);
+    quiet_end();
+
+    uint32_t min = 0xFFFFFFFF, max = 0, erases = 0;
+    printf("  %-34s", name);
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        uint32_t cnt = wear_base[i] + hal_flash_get_erase_count(nvs_sector_addr(i));
+        printf(" %4u", cnt);
+        if (cnt < min) min = cnt;
+        if (cnt > max) max = cnt;
+        erases += cnt - (preset ? preset[i] : 0);
+    }
+    printf("   spread=%-4u erases=%-4u gc=%u\n", max - min, erases, stats.gc_count);
+}
+
+static void bench_wear_leveling(void) {
+    // 扇区 1~3 已经被磨损，数据从低磨损的扇区 0 开始
+    static const uint32_t skew_one[NVS_SECTOR_COUNT] = { 0, 60, 60, 60 };
+    // 两片 Flash: 器件 0 (扇区 0, 2) 是用旧了的，器件 1 (扇区 1, 3) 是后加的新片子
+    static const uint32_t skew_dev[NVS_SECTOR_COUNT] = { 60, 0, 60, 0 };
+
+    printf("\n--- Physical erase counts per sector (%d reboot cycles, erases = added this run) ---\n", WL_CYCLES);
+
+    // 热负载: 擦除次数能否在重启后保留，决定了动态均衡是否有效
+    bench_wear_case("hot, counts lost on reboot", 1, NULL, 150, 1, 1, 0);
+    bench_wear_case("hot, counts persisted", 1, NULL, 150, 1, 0, 0);
+
+    // 两片 Flash、每个周期 GC 之后不等 nvs_poll 就重启: 旧扇区的空闲头部还没写，
+    // 擦除次数靠新扇区里的擦除记录恢复，分布和上一行一样均匀，也没有多出来的擦除
+    bench_wear_case("2 dev hot, reboot before poll", 2, NULL, 150, 0, 0, 1);
+
+    // 单片预置偏斜 + 以冷数据为主、偶尔 GC: 单片时 GC 本来就只按擦除次数选目标，
+    // 活动扇区一直有追加也不算冷数据，开不开静态均衡结果一样，只列一行
+    bench_wear_case("1 dev skewed mixed", 1, skew_one, 40, 8, 0, 1);
+
+    // 两片 Flash、低磨损扇区都在同一片上:
+    // device-first 始终优先跨器件 (nvs_set_static_wl(0))，旧片子承担一半的 GC；
+    // wear-first 在磨损差超过阈值时只按擦除次数选目标，GC 留在新片子上，直到差值回到阈值以内
+    // 这里的差别全部来自 GC 选目标，冷数据搬运 (nvs_static_wl_step) 一次都没有发生
+    bench_wear_case("2 dev skewed mixed, device-first", 2, skew_dev, 40, 8, 0, 0);
+    bench_wear_case("2 dev skewed mixed, wear-first", 2, skew_dev, 40, 8, 0, 1);
+    bench_wear_case("2 dev skewed hot, device-first", 2, skew_dev, 150, 8, 0, 0);
+    bench_wear_case("2 dev skewed hot, wear-first", 2, skew_dev, 150, 8, 0, 1);
+
+    // 恢复成单片 Flash (布局变了，重新格式化)
+    quiet_begin();
+    hal_flash_init();
+    nvs_set_static_wl(1);
+    nvs_format_all();
+    quiet_end();
+}
+
+// --- 读缓存: 挂载扫描和 GC 搬运时发给 HAL 的读取次数 ---
+static void bench_cache_case(int enable) {
+    hal_cache_stats_t mount_stats, gc_stats;
+
+    quiet_begin();
+    hal_cache_enable(enable);
+
+    // 先把活动扇区写到接近满，让挂载有足够多的条目要扫描
+    wear_reset(NULL);
+    for (uint32_t i = 0; g_nvs.write_offset < NVS_SECTOR_SIZE - 256; i++) {
+        char key[32];
+        make_key(key, i % BENCH_KEYS);
+        uint8_t val[32];
+        memset(val, i, sizeof(val));
+        nvs_set(key, val, sizeof(val));
+    }
+
+    hal_cache_reset_stats();
+    double start = sim_us();
+    nvs_init();
+    double mount_us = sim_us() - start;
+    hal_cache_get_stats(&mount_stats);
+
+    hal_cache_reset_stats();
+    start = sim_us();
+    nvs_execute_gc();
+    double gc_us = sim_us() - start;
+    hal_cache_get_stats(&gc_stats);
+
+    hal_cache_enable(1);
+    quiet_end();
+
+    printf("  cache %-3s  mount: %4u reads -> %4u HAL reads (%5u bytes) %8.1f sim us   gc: %4u -> %4u HAL reads %8.1f sim us\n",
+           enable ? "on" : "off",
+           mount_stats.reads, mount_stats.hal_reads, mount_stats.hal_read_bytes, mount_us,
+           gc_stats.reads, gc_stats.hal_reads, gc_us);
+}
+
+static void bench_read_cache(void) {
+    printf("\n--- HAL read calls for mount and GC (%d-byte pages, %dx%d cache) ---\n",
+           FLASH_PAGE_SIZE, HAL_CACHE_SETS, HAL_CACHE_WAYS);
+
+    bench_cache_case(0);
+    bench_cache_case(1);
+}
+
+// --- 计数器: 每次写一条新的 u32 条目 vs 位图原地清位 ---
+#define COUNTER_INCS    5000
+
+static void bench_counter_case(int use_counter) {
+    nvs_stats_t stats;
+
+    quiet_begin();
+    wear_reset(NULL);
+    nvs_reset_stats();
+
+    uint32_t physical_erases = 0;
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) physical_erases -= hal_flash_get_erase_count(nvs_sector_addr(i));
+
+    double start = sim_us();
+    for (uint32_t i = 1; i <= COUNTER_INCS; i++) {
+        if (use_counter) {
+            nvs_counter_inc("bench_boot_count", NULL);
+        }
+        else {
+            nvs_set("bench_boot_count", &i, sizeof(i));
+        }
+    }
+    double elapsed = sim_us() - start;
+
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) physical_erases += hal_flash_get_erase_count(nvs_sector_addr(i));
+    nvs_get_stats(&stats);
+    quiet_end();
+
+    // 追加的条目消耗扇区空间；原地清位每次只改写已有条目里的 1 字节
+    printf("  %-15s  entries: %5u  appended: %6u B  in-place: %5u B  gc: %3u  erases: %3u  %8.1f sim us/inc\n",
+           use_counter ? "nvs_counter_inc" : "nvs_set u32",
+           stats.write_count, stats.write_bytes, stats.counter_bit_clears, stats.gc_count, physical_erases,
+           elapsed / COUNTER_INCS);
+}
+
+static void bench_counter(void) {
+    printf("\n--- %d counter increments (%d-bit bitmap per entry) ---\n", COUNTER_INCS, NVS_COUNTER_BITS);
+
+    bench_counter_case(0);
+    bench_counter_case(1);
+}
+
+// --- 写延迟: 模拟 NOR 时序下跨越多次 GC 的 nvs_set 延迟 ---
+#define LATENCY_WRITES  2000
+#define LATENCY_IDLE_US 1000            // 两次写之间 CPU 做别的事情的时间
+
+static void bench_latency_case(const char *name, int devices) {
+    static const hal_flash_timing_t timing = HAL_FLASH_TIMING_NOR;
+    nvs_stats_t stats;
+
+    quiet_begin();
+    hal_flash_init();
+    if (devices > 1) {
+        remove("flash_mock_1.bin");
+        hal_flash_add_device("flash_mock_1.bin");
+    }
+    hal_flash_set_timing(&timing);
+    nvs_init();
+    wear_reset(NULL);
+    nvs_reset_stats();
+
+    uint64_t total_ns = 0;
+    uint64_t worst_ns = 0;
+    uint64_t wait_start = hal_flash_get_wait_ns();
+
+    for (uint32_t i = 0; i < LATENCY_WRITES; i++) {
+        char key[32];
+        uint8_t val[32];
+        make_key(key, i % BENCH_KEYS);
+        memset(val, i, sizeof(val));
+
+        uint64_t start = hal_flash_now_ns();
+        nvs_set(key, val, sizeof(val));
+        uint64_t latency = hal_flash_now_ns() - start;
+
+        total_ns += latency;
+        if (latency > worst_ns) worst_ns = latency;
+        hal_flash_advance_ns(LATENCY_IDLE_US * 1000ull);
+    }
+
+    uint64_t wait_ns = hal_flash_get_wait_ns() - wait_start;
+    nvs_get_stats(&stats);
+    quiet_end();
+
+    printf("  %-24s gc: %3u  avg: %8.1f us  worst: %8.1f us  erase wait: %8.1f ms\n",
+           name, stats.gc_count, total_ns / 1e3 / LATENCY_WRITES, worst_ns / 1e3, wait_ns / 1e6);
+}
+
+static void bench_write_latency(void) {
+    printf("\n--- nvs_set latency on simulated NOR timing (%d writes, %d us idle between writes) ---\n",
+           LATENCY_WRITES, LATENCY_IDLE_US);
+
+    bench_latency_case("1 device", 1);
+    bench_latency_case("2 devices", 2);
+
+    // 恢复成单片 Flash
+    quiet_begin();
+    hal_flash_init();
+    hal_flash_set_timing(NULL);
+    quiet_end();
+}
+
+int main(void) {
+    // 每次跑 benchmark 都从空白 Flash 开始
+    remove("flash_mock.bin");
+
+    if (hal_flash_init() != 0 || nvs_init() != 0) {
+        printf("Init failed!\n");
+        return -1;
+    }
+
+    // 所有结果里的 "sim" 时间都来自 Mock 的典型 SPI NOR 时序模型
+    static const hal_flash_timing_t nor_timing = HAL_FLASH_TIMING_NOR;
+    hal_flash_set_timing(&nor_timing);
+
+    bench_prepare();
+    bench_verify_policy();
+    bench_key_handle();
+    bench_wear_leveling();
+    bench_read_cache();
+    bench_counter();
+    bench_write_latency();
+
+    return 0;
+}
@@ -0,0 +1,15 @@
+// 由 nvs_image keygen 根据 tools/example.manifest 生成，不要手动修改
+#ifndef NVS_KEYS_GENERATED_H
+#define NVS_KEYS_GENERATED_H
+
+#include "tinynvs_def.h"
+
+#define NVS_KEY_WIFI_SSID                NVS_KEY_CONST("wifi_ssid", 0x116CD2A1u)
+#define NVS_KEY_WIFI_PASSWORD            NVS_KEY_CONST("wifi_password", 0x15900E1Du)
+#define NVS_KEY_DEVICE_NAME              NVS_KEY_CONST("device_name", 0xD71AAB3Cu)
+#define NVS_KEY_BOOT_MODE                NVS_KEY_CONST("boot_mode", 0x7CD7BCEDu)
+#define NVS_KEY_LOG_LEVEL                NVS_KEY_CONST("log_level", 0xBA94274Eu)
+#define NVS_KEY_CAL_TABLE                NVS_KEY_CONST("cal_table", 0x1E63ED02u)
+#define NVS_KEY_BOOT_COUNT               NVS_KEY_CONST("boot_count", 0x1A8DBD3Cu)
+
+#endif
@@ -8,9 +8,52 @@
 #define FLASH_PAGE_SIZE 256
 #define FLASH_TOTAL_SIZE  (1024 * 1024)
 
+// --- 多片 Flash ---
+// 地址高 8 位是器件号，低 24 位是器件内地址；只有一片时和原来的平坦地址完全一样
+#define HAL_FLASH_MAX_DEVICES       4
+#define HAL_FLASH_DEV_SHIFT         24
+#define HAL_FLASH_ADDR(dev, offset) (((uint32_t)(dev) << HAL_FLASH_DEV_SHIFT) | (uint32_t)(offset))
+#define HAL_FLASH_ADDR_DEV(addr)    ((uint32_t)(addr) >> HAL_FLASH_DEV_SHIFT)
+#define HAL_FLASH_ADDR_OFFSET(addr) ((uint32_t)(addr) & ((1u << HAL_FLASH_DEV_SHIFT) - 1))
+
 int hal_flash_init(void);
+int hal_flash_add_device(const char *path);
+int hal_flash_device_count(void);
 int hal_flash_read(uint32_t addr, void *buf, size_t len);
 int hal_flash_write(uint32_t addr,const void *buf, size_t len);
 int hal_flash_erase(uint32_t sector_addr); 
+// 异步擦除: 启动后立即返回，同一片 Flash 的下一次访问会先等它完成
+// 其他器件上的读写不受影响，可以和擦除并行
+int hal_flash_erase_start(uint32_t sector_addr);
+int hal_flash_sync(int dev);
+
+// Mock 诊断接口: 某个扇区被物理擦除的总次数 (测试和 benchmark 用)
+uint32_t hal_flash_get_erase_count(uint32_t sector_addr);
+
+// --- Mock 时序模型 ---
+// 每个操作按配置推进一个虚拟时钟 (纳秒)，不真正等待，同样的操作序列得到同样的时间
+// 异步擦除在虚拟时钟走到结束时间之前都算 "忙"，期间访问同一片 Flash 要忙等，
+// 或者 (erase_suspend) 暂停擦除先做这次访问，擦除的结束时间相应顺延
+typedef struct {
+    uint32_t read_setup_ns;                 //每次读命令的固定开销 (指令 + 地址)
+    uint32_t read_byte_ns;                  //每读一个字节
+    uint32_t program_page_ns;               //每编程一页 (一次写跨几页算几页)
+    uint32_t erase_sector_ns;               //每擦除一个扇区
+    uint32_t jitter_pct;                    //编程/擦除耗时的随机抖动 (±百分比)，0 表示没有
+    uint32_t jitter_seed;
+    uint8_t erase_suspend;                  //1: 擦除期间的访问先暂停擦除；0: 忙等擦除结束
+    uint32_t suspend_ns;                    //一次暂停 + 恢复擦除的额外开销
+} hal_flash_timing_t;
+
+// 典型 SPI NOR (4KB 扇区擦除 45ms, 页编程 0.7ms, 读约 40MB/s)
+#define HAL_FLASH_TIMING_NOR { 1000, 25, 700000, 45000000, 0, 1, 0, 20000 }
+
+// timing 为 NULL 时关闭时序模型 (所有操作耗时为 0，默认状态)
+void hal_flash_set_timing(const hal_flash_timing_t *timing);
+uint64_t hal_flash_now_ns(void);
+// CPU 做别的事情花掉的时间，后台擦除可以在这段时间里完成
+void hal_flash_advance_ns(uint64_t ns);
+// 累计因为擦除忙而等待的时间
+uint64_t hal_flash_get_wait_ns(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,40 @@
+#ifndef HAL_FLASH_CACHE_H
+#define HAL_FLASH_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal_flash.h"
+
+// --- Flash 读缓存 ---
+// 夹在 NVS 核心和 HAL 之间: 以 FLASH_PAGE_SIZE 为单位缓存，组相联 + LRU 替换
+// 挂载和 GC 时的大量小读取 (12 字节头部、Key、Data) 合并成少量整页读取
+// 缓存页是 RAM 里的副本，看不到页被缓存之后 Flash 里发生的位翻转，
+// 所以 CRC 校验、巡检和重复写入比较都绕过缓存直接读 Flash
+#define HAL_CACHE_SETS          8
+#define HAL_CACHE_WAYS          2
+// 顺序扫描时每次未命中额外预读的页数
+#define HAL_CACHE_READ_AHEAD    3
+// 一次 HAL 读取最多读多少页
+#define HAL_CACHE_MAX_BURST     4
+
+typedef struct {
+    uint32_t reads;                     //上层的读请求次数
+    uint32_t hits;                      //命中的页
+    uint32_t misses;                    //未命中的页 (触发 HAL 读取)
+    uint32_t hal_reads;                 //实际发给 HAL 的读取次数
+    uint32_t hal_read_bytes;            //实际从 HAL 读取的字节数
+} hal_cache_stats_t;
+
+int hal_cache_read(uint32_t addr, void *buf, size_t len);
+// 写穿透: 先写 Flash，再按 NOR 语义 (只能 1->0) 更新已缓存的页
+int hal_cache_write(uint32_t addr, const void *buf, size_t len);
+// 擦除前先让该扇区的缓存页失效
+int hal_cache_erase(uint32_t sector_addr);
+int hal_cache_erase_start(uint32_t sector_addr);
+
+void hal_cache_invalidate(void);
+void hal_cache_enable(int enable);
+void hal_cache_get_stats(hal_cache_stats_t *stats);
+void hal_cache_reset_stats(void);
+
+#endif
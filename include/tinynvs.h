@@ -7,18 +7,60 @@
 int nvs_format_sector(uint32_t sector_addr, uint32_t old_erase_count, uint32_t seq_id);
 int nvs_change_sector_state(uint32_t sector_addr, nvs_sector_state_t new_state);
 int nvs_append_entry(uint32_t sector_addr, uint32_t current_offset, const char *key, const void *data, uint16_t len);
+int nvs_append_raw(uint32_t sector_addr, uint32_t current_offset, uint8_t type, const void *key, uint8_t key_len, const void *data, uint16_t len);
+int nvs_append_counter(uint32_t sector_addr, uint32_t current_offset, const char *key, uint8_t key_len, uint32_t base);
 int nvs_get(const char *key, void *buf, uint16_t len);
+int nvs_key_init(nvs_key_t *handle, const char *key);
 uint32_t nvs_index_find(const char *key);
-void nvs_index_update(const char *key, uint32_t offset);
+nvs_index_node_t *nvs_index_lookup(const char *key);
+nvs_index_node_t *nvs_index_lookup_hash(uint32_t hash);
+nvs_index_node_t *nvs_index_update(const char *key, uint32_t offset);
+nvs_index_node_t *nvs_index_update_hash(uint32_t hash, uint32_t offset);
+uint16_t nvs_dict_alloc_id(void);
+void nvs_dict_bind(uint16_t key_id, uint32_t key_hash, uint32_t def_offset);
 uint32_t nvs_mount(uint32_t sector_addr);
 void nvs_index_clear(void);
 uint32_t nvs_index_gc_copy_data(uint32_t src_sector, uint32_t dst_sector);
 void nvs_index_remove(const char *key);
+void nvs_index_remove_hash(uint32_t hash);
 int nvs_set(const char *key, const void *data,uint16_t len);
+int nvs_set_direct(const nvs_key_t *key, const void *data, uint16_t len);
 int nvs_delete(uint32_t sector_addr, const char *key);
+int nvs_get_by_handle(const nvs_key_t *key, void *buf, uint16_t len);
+int nvs_set_by_handle(const nvs_key_t *key, const void *data, uint16_t len);
+int nvs_delete_by_handle(uint32_t sector_addr, const nvs_key_t *key);
+void nvs_set_verify_policy(nvs_verify_policy_t policy);
+void nvs_set_corrupt_callback(nvs_corrupt_cb_t cb);
+int nvs_scrub(uint32_t budget_bytes);
+
+int nvs_writeback_enable(const char *key, uint32_t max_delay_ms);
+int nvs_writeback_disable(const char *key);
+int nvs_flush(void);
+int nvs_poll(uint32_t now_ms);
+int nvs_wb_store(const nvs_key_t *key, const void *data, uint16_t len);
+int nvs_wb_load(const nvs_key_t *key, void *buf, uint16_t len);
+int nvs_wb_drop(const nvs_key_t *key);
+void nvs_wb_discard(void);
+
+int nvs_counter_inc(const char *key, uint32_t *value);
+int nvs_counter_get(const char *key, uint32_t *value);
+int nvs_counter_read(const nvs_index_node_t *node, uint32_t *value);
+int nvs_counter_value(const void *data, uint32_t *value);
 
 int nvs_init(void);
+int nvs_format_all(void);
+uint32_t nvs_sector_addr(int idx);
 int nvs_execute_gc(void);
+int nvs_sector_begin_copy(uint32_t *dst_sector);
+void nvs_sector_commit_copy(uint32_t dst_sector, uint32_t write_offset);
+void nvs_sector_abort_copy(uint32_t dst_sector);
+int nvs_export(nvs_export_cb_t cb, void *ctx);
+int nvs_import(nvs_import_cb_t cb, void *ctx);
 int nvs_check_and_execute_static_wl(void);
+int nvs_static_wl_step(uint32_t budget_bytes);
+void nvs_set_static_wl(int enable);
+void nvs_flush_pending_stamp(void);
+void nvs_get_stats(nvs_stats_t *stats);
+void nvs_reset_stats(void);
 
 #endif
\ No newline at end of file
@@ -11,16 +11,29 @@
 // 静态磨损均衡阈值
 // 当 (最大擦除次数 - 最小擦除次数) > 此值时，触发强制搬运
 #define NVS_STATIC_WL_THRESHOLD   10
+// 活动扇区自挂载或搬入以来没有任何追加，并且连续这么多次检查都是如此，才认为里面是冷数据
+#define NVS_STATIC_WL_COLD_CHECKS 3
 #define NVS_MAX_KEYS        64
 #define NVS_KEY_MAX_LEN     128
 #define NVS_DATA_MAX_LEN     256
 
+// --- 键字典 (Key Dictionary) ---
+// 开启后，Key 第一次写入时先追加一条 "Key -> 16bit ID" 的定义条目，
+// 之后该 Key 的数据条目只存 2 字节 ID，不再重复存完整的 Key 字符串
+#define NVS_KEY_DICT_ENABLE     1
+// Key 长度不超过此值时直接内联存储 (换成 ID 也省不了空间)
+#define NVS_KEY_DICT_MIN_LEN    4
+#define NVS_KEY_ID_NONE         0xFFFF
+
 typedef enum {
     SECTOR_STATE_EMPTY = 0xFFFFFFFF,
     SECTOR_STATE_COPYING = 0xFFFF0000,
     SECTOR_STATE_USED = 0x00000000        
 } nvs_sector_state_t;
 
+// 空闲扇区擦除后也写一个头部来保存擦除次数，seq_id 为此值表示扇区空闲
+#define NVS_FREE_SEQ_ID     0xFFFFFFFF
+
 typedef struct {
     uint32_t magic;                         //固定标识
     uint32_t erase_count;                   //擦除计数（用于磨损平衡）
@@ -28,12 +41,32 @@ typedef struct {
     uint32_t seq_id;
 } nvs_sector_header_t;
 
+// 扇区头部的 magic 同时记录写入时条带化的器件数 (nvs_sector_addr 的布局):
+// 最高字节异或上 (器件数 - 1)。单片时就是 NVS_MAGIC，和旧格式完全相同；
+// 头部大小不变，条目偏移也不变
+#define NVS_SECTOR_MAGIC(devs)  (NVS_MAGIC ^ ((uint32_t)((devs) - 1) << 24))
+
 typedef enum {
     ENTRY_STATE_EMPTY = 0xFFFFFFFF,
     ENTRY_STATE_VALID = 0xFFFF0000,          //有效数据
     ENTRY_STATE_DELETED = 0x00000000
 } nvs_entry_state_t;
 
+typedef enum {
+    ENTRY_TYPE_DATA = 0,                    //普通数据: payload = key 字符串 + data
+    ENTRY_TYPE_KEY_DEF = 1,                 //字典定义: payload = key 字符串 + 16bit ID
+    ENTRY_TYPE_DATA_ID = 2,                 //短 ID 数据: payload = 16bit ID + data
+    ENTRY_TYPE_COUNTER = 3,                 //计数器: payload = key 字符串 + 32bit 基数 + 一元位图
+    ENTRY_TYPE_WEAR = 4                     //擦除记录: 没有 key, payload = nvs_wear_record_t
+} nvs_entry_type_t;
+
+// GC 跨器件提交时旧扇区是异步擦除的，空闲头部要推迟到擦除结束后才能写；
+// 在这之前重启，旧扇区的擦除次数就只剩这条记录 (写在新扇区里，和提交一起生效)
+typedef struct {
+    uint32_t sector_idx;
+    uint32_t erase_count;                   //旧扇区这次擦除之后的擦除次数
+} nvs_wear_record_t;
+
 typedef struct {
     uint8_t key_len;
     uint8_t type;
@@ -48,23 +81,144 @@ typedef struct {
 #define NVS_ENTRY_SIZE(k_len, d_len) \
     (sizeof(nvs_entry_header_t) + ALIGN_UP((k_len) + (d_len), 4))
 
+// --- 单调计数器 ---
+// 每次加一只把位图里下一个还是 1 的位清成 0 (NOR Flash 不擦除也能 1->0)，
+// 计数值 = 基数 + 已清掉的位数；位图用完才追加一条新的基数条目
+#define NVS_COUNTER_BITS        512
+#define NVS_COUNTER_DATA_LEN    (sizeof(uint32_t) + NVS_COUNTER_BITS / 8)
+
+// 条目 data 部分参与 CRC 的长度
+// 计数器的位图会被原地改写，所以 CRC 只覆盖 Key 和基数；
+// 位图本身没有 CRC 保护，读取时只检查它是否连续 (见 nvs_counter_value)
+#define NVS_ENTRY_CRC_DATA_LEN(type, d_len) \
+    ((type) == ENTRY_TYPE_COUNTER ? sizeof(uint32_t) : (d_len))
+
+// --- Key 句柄 ---
+// 预先算好 Key 的 CRC32 和长度，*_by_handle 接口在热路径上不再 strlen / 计算哈希
+// 运行时用 nvs_key_init 创建；C++ 可以用 tinynvs_key.hpp 在编译期生成，
+// C 可以用 nvs_image keygen 生成 NVS_KEY_CONST 常量
+typedef struct {
+    const char *name;                       //必须在句柄的整个生命周期内有效 (通常是字符串字面量)
+    uint32_t hash;                          //crc32(name)，必须和 name 一致
+    uint8_t len;
+} nvs_key_t;
+
+// name 必须是字符串字面量: "" name "" 对指针或数组变量会直接编译报错，
+// 否则 sizeof 得到的是指针或数组的大小，长度就错了
+#define NVS_KEY_CONST(name, hash)   { "" name "", (hash), sizeof("" name "") - 1 }
+
 typedef struct nvs_index_node {
     uint32_t key_hash;
     uint32_t offset;
     struct nvs_index_node *next;
+    uint16_t key_id;                        //字典 ID, NVS_KEY_ID_NONE 表示 Key 内联存储
+    uint16_t data_len;                      //当前值的长度 (摘要的一部分)
+    uint32_t crc;                           //当前条目头里的 CRC (摘要的一部分)
+    uint8_t key_len;                        //条目里 Key 部分的长度 (短 ID 条目为 2)
+    uint8_t type;                           //当前条目的类型 (nvs_entry_type_t)
     uint8_t used;
 } nvs_index_node_t;
 
+// 字典表: 下标就是 ID
+typedef struct {
+    uint32_t key_hash;
+    uint32_t offset;                        //定义条目在活动扇区内的偏移, 0 表示该 ID 空闲
+} nvs_key_dict_t;
+
+// --- 写回缓冲 (Write-Back) ---
+// 高频更新的 Key 可以开启写回: nvs_set 只更新 RAM 里的缓存，
+// 到期 (nvs_poll)、缓存的数据量超过阈值或显式 nvs_flush 时才批量写进 Flash
+#define NVS_WB_SLOTS            4
+#define NVS_WB_FLUSH_BYTES      512     // 待写数据超过此值时立即整体刷写
+
+typedef struct {
+    uint32_t key_hash;
+    char key[NVS_KEY_MAX_LEN + 1];
+    uint8_t key_len;                        //开启写回时记下，刷写时不用再 strlen
+    uint8_t data[NVS_DATA_MAX_LEN];
+    uint16_t data_len;
+    uint32_t max_delay_ms;                  //允许丢失的最长时间窗口
+    uint32_t deadline_ms;                   //变脏之后最迟的落盘时间
+    uint8_t used;
+    uint8_t dirty;
+} nvs_wb_slot_t;
+
+// --- 完整性校验策略 ---
+typedef enum {
+    NVS_VERIFY_ALWAYS = 0,                  //每次 nvs_get 都重读头部和 Key，校验完整 CRC (默认)
+    NVS_VERIFY_ON_MOUNT,                    //只在挂载/写入时校验，之后信任 RAM 索引
+    NVS_VERIFY_SAMPLED                      //信任 RAM 索引，每 NVS_VERIFY_SAMPLE_RATE 次读取抽查一次
+} nvs_verify_policy_t;
+
+#define NVS_VERIFY_SAMPLE_RATE  16
+
+// 发现损坏条目时的回调 (nvs_get 校验失败或 nvs_scrub 巡检发现)
+typedef void (*nvs_corrupt_cb_t)(uint32_t key_hash, uint32_t offset);
+
+// --- 快照导出/导入 ---
+// 流格式 (小端): 流头部 + count 条记录
+// 每条记录: 记录头 + key + data + CRC32 (覆盖记录头、key、data)
+#define NVS_SNAPSHOT_MAGIC      0x5353564E  // "NVSS"
+#define NVS_SNAPSHOT_VERSION    1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;                         //记录条数
+    uint32_t crc;                           //覆盖前面三个字段
+} nvs_snapshot_header_t;
+
+typedef struct {
+    uint8_t key_len;
+    uint8_t type;                           //DATA 或 COUNTER，导出时 Key 总是展开为完整字符串，计数器只存 32 位计数值
+    uint16_t data_len;
+} nvs_snapshot_record_t;
+
+// 导出回调: 每次收到一段连续的流数据，返回非 0 中止导出
+typedef int (*nvs_export_cb_t)(const void *buf, size_t len, void *ctx);
+// 导入回调: 读满 len 字节，返回非 0 表示流提前结束或出错
+typedef int (*nvs_import_cb_t)(void *buf, size_t len, void *ctx);
+
+// --- 运行统计 ---
+typedef struct {
+    uint32_t write_count;                   //实际追加的数据条目数
+    uint32_t write_bytes;                   //nvs_set 实际写入 Flash 的字节数 (含头部和字典定义)
+    uint32_t suppressed_writes;             //值没有变化而被跳过的 nvs_set 次数
+    uint32_t gc_count;                      //GC 执行次数
+    uint32_t corrupt_count;                 //读取或巡检时发现的损坏条目数
+    uint32_t coalesced_writes;              //被写回缓冲吸收的 nvs_set 次数
+    uint32_t wb_flushes;                    //写回缓冲批量落盘次数
+    uint32_t wl_migrations;                 //静态磨损均衡搬运次数
+    uint32_t counter_bit_clears;            //原地清位完成的计数器加一次数 (不追加条目)
+} nvs_stats_t;
+
 // --- 扇区管理器配置 ---
-#define NVS_BASE_ADDR       0x00000000  // Flash 起始地址
-#define NVS_SECTOR_COUNT    4           // 我们管理 4 个扇区 (0x0000, 0x1000, 0x2000, 0x3000)
+#define NVS_BASE_ADDR       0x00000000  // 每片 Flash 上的起始地址
+#define NVS_SECTOR_COUNT    4           // 我们管理 4 个扇区 (单片时为 0x0000, 0x1000, 0x2000, 0x3000)
+                                        // 多片时按下标轮流分布到各个器件上，见 nvs_sector_addr()
 
 typedef struct {
+    uint32_t device_count;                  //参与条带化的 Flash 器件数 (nvs_init 时从 HAL 读取)
     uint32_t active_sector_addr;
     uint32_t write_offset;
     uint32_t current_seq_id;
     uint32_t sector_erase_counts[NVS_SECTOR_COUNT];
+    uint32_t wl_base_offset;                //活动扇区挂载或搬入时的 write_offset (判断冷数据用)
+    uint8_t wl_cold_checks;                 //活动扇区连续没有追加的检查次数
+    uint8_t wl_force_min;                   //磨损差超过阈值: GC 选目标时只看擦除次数，不再优先跨器件
+    uint8_t wl_static_off;                  //1: 关闭静态磨损均衡，只保留动态均衡
+    uint8_t stamp_pending;                  //异步擦除的旧扇区还没写空闲头部
+    uint32_t stamp_pending_sector;
+    int8_t wear_record_idx;                 //活动扇区里擦除记录指向的扇区下标，-1 表示没有 (nvs_mount 时设置)
     nvs_index_node_t node_pool[NVS_MAX_KEYS];
+    nvs_key_dict_t key_dict[NVS_MAX_KEYS];
+    nvs_stats_t stats;
+    nvs_verify_policy_t verify_policy;
+    uint32_t verify_read_count;             //抽查模式下的读取计数
+    uint32_t scrub_cursor;                  //巡检进度 (node_pool 下标)
+    nvs_corrupt_cb_t corrupt_cb;
+    nvs_wb_slot_t wb_slots[NVS_WB_SLOTS];
+    uint32_t wb_now_ms;                     //最近一次 nvs_poll 传入的时间
 } nvs_manager_t;
 
 extern nvs_manager_t g_nvs;
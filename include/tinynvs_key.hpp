@@ -0,0 +1,40 @@
+#ifndef TINYNVS_KEY_HPP
+#define TINYNVS_KEY_HPP
+
+// 编译期生成 Key 句柄 (需要 C++14)
+//
+//   static constexpr nvs_key_t kBootMode = tinynvs::make_key("boot_mode");
+//   nvs_set_by_handle(&kBootMode, &mode, sizeof(mode));
+//
+// 哈希算法和 crc32.c 完全相同，结果可以和字符串接口混用
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "tinynvs.h"
+}
+
+namespace tinynvs {
+
+constexpr uint32_t crc32(const char *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint8_t)data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+        }
+    }
+    return ~crc;
+}
+
+template <size_t N>
+constexpr nvs_key_t make_key(const char (&name)[N]) {
+    static_assert(N - 1 <= NVS_KEY_MAX_LEN, "NVS key too long");
+    return nvs_key_t{ name, crc32(name, N - 1), (uint8_t)(N - 1) };
+}
+
+} // namespace tinynvs
+
+#endif
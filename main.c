@@ -2,6 +2,7 @@
 #include <string.h>
 #include "tinynvs.h"
 #include "hal_flash.h"
+#include "hal_flash_cache.h"
 
 // 打印测试结果的辅助宏
 #define TEST_ASSERT(cond, msg) \
@@ -100,6 +101,632 @@ void test_stress_gc(void) {
     TEST_ASSERT(strlen(buf) > 0, "Can read data after heavy GC");
 }
 
+void test_key_dict(void) {
+    printf("\n=== Test 4: Key Dictionary (Short Key IDs) ===\n");
+
+    const char *key = "sensor_temperature_reading";
+    uint32_t val;
+    uint32_t buf = 0;
+    int ret;
+
+    // 第一次写入: 定义条目 + 短 ID 数据条目
+    val = 1;
+    ret = nvs_set(key, &val, sizeof(val));
+    TEST_ASSERT(ret == 0, "First write of long key");
+
+    // 之后的写入只带 2 字节 ID
+    uint32_t before = g_nvs.write_offset;
+    val = 2;
+    ret = nvs_set(key, &val, sizeof(val));
+    TEST_ASSERT(ret == 0 && g_nvs.write_offset - before == NVS_ENTRY_SIZE(sizeof(uint16_t), sizeof(val)),
+                "Update stores only the key id");
+
+    ret = nvs_get(key, &buf, sizeof(buf));
+    TEST_ASSERT(ret == sizeof(buf) && buf == 2, "Get long key by id");
+
+    // GC 之后字典被压缩搬运，重启后从 Flash 重建
+    TEST_ASSERT(nvs_execute_gc() == 0, "Force GC with dictionary entries");
+    TEST_ASSERT(nvs_init() == 0, "Re-Init after GC");
+
+    buf = 0;
+    ret = nvs_get(key, &buf, sizeof(buf));
+    TEST_ASSERT(ret == sizeof(buf) && buf == 2, "Long key survives GC and reboot");
+
+    char str[64];
+    memset(str, 0, sizeof(str));
+    ret = nvs_get("wifi_ssid", str, sizeof(str));
+    TEST_ASSERT(ret > 0 && strcmp(str, "OfficeWiFi") == 0, "Other keys survive GC and reboot");
+}
+
+void test_redundant_write(void) {
+    printf("\n=== Test 5: Redundant Write Suppression ===\n");
+
+    nvs_stats_t stats;
+    const char *cfg = "baud=115200;parity=none";
+    int ret;
+
+    ret = nvs_set("uart_cfg", cfg, strlen(cfg));
+    TEST_ASSERT(ret == 0, "Set 'uart_cfg'");
+
+    nvs_reset_stats();
+    uint32_t before = g_nvs.write_offset;
+
+    // 同样的值再写一遍，不应该追加新条目
+    ret = nvs_set("uart_cfg", cfg, strlen(cfg));
+    nvs_get_stats(&stats);
+    TEST_ASSERT(ret == 0 && g_nvs.write_offset == before && stats.suppressed_writes == 1 && stats.write_count == 0,
+                "Unchanged value is not rewritten");
+
+    // 长度相同但内容不同，必须真正写入
+    const char *cfg2 = "baud=115200;parity=even";
+    ret = nvs_set("uart_cfg", cfg2, strlen(cfg2));
+    nvs_get_stats(&stats);
+    TEST_ASSERT(ret == 0 && g_nvs.write_offset > before && stats.write_count == 1, "Changed value is written");
+
+    char small[4];
+    ret = nvs_get("uart_cfg", small, sizeof(small));
+    TEST_ASSERT(ret == -3, "Too-small buffer rejected");
+}
+
+static int get_active_idx(void) {
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        if (nvs_sector_addr(i) == g_nvs.active_sector_addr) return i;
+    }
+    return -1;
+}
+
+static int g_corrupt_reports = 0;
+
+static void on_corrupt(uint32_t key_hash, uint32_t offset) {
+    printf("  -> corrupt callback: hash 0x%08X offset %d\n", key_hash, offset);
+    g_corrupt_reports++;
+}
+
+void test_verify_policy(void) {
+    printf("\n=== Test 6: Integrity Verification Policy ===\n");
+
+    char buf[32];
+    int ret;
+
+    ret = nvs_set("boot_mode", "normal", strlen("normal"));
+    TEST_ASSERT(ret == 0, "Set 'boot_mode'");
+
+    // 模拟位翻转: 把数据区第一个字节的 bit 清零 (1->0 不需要擦除)
+    uint32_t data_addr = g_nvs.active_sector_addr + nvs_index_find("boot_mode")
+                       + sizeof(nvs_entry_header_t) + nvs_index_lookup("boot_mode")->key_len;
+    uint8_t flipped = 'n' & ~0x02;
+    hal_flash_write(data_addr, &flipped, 1);
+
+    nvs_set_corrupt_callback(on_corrupt);
+
+    // 信任索引: 不重新校验，读到的是损坏的数据
+    nvs_set_verify_policy(NVS_VERIFY_ON_MOUNT);
+    ret = nvs_get("boot_mode", buf, sizeof(buf));
+    TEST_ASSERT(ret == (int)strlen("normal"), "Trusted read skips CRC check");
+
+    // 每次校验: CRC 不匹配，返回错误并回调
+    nvs_set_verify_policy(NVS_VERIFY_ALWAYS);
+    ret = nvs_get("boot_mode", buf, sizeof(buf));
+    TEST_ASSERT(ret == -2 && g_corrupt_reports == 1, "Verified read detects corruption");
+
+    // 后台巡检: 有足够预算时一轮能扫完所有 Key
+    ret = nvs_scrub(NVS_SECTOR_SIZE);
+    TEST_ASSERT(ret == 1 && g_corrupt_reports == 2, "Scrub reports corrupted entry");
+
+    // 预算小于存活数据: 每轮只扫一部分，下一轮从游标停下的地方继续
+    // 把游标放在损坏条目后面，让它排在这一圈的最后
+    int bad = nvs_index_lookup("boot_mode") - g_nvs.node_pool;
+    int live = 0;
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        if (g_nvs.node_pool[i].used && g_nvs.node_pool[i].offset != 0) live++;
+    }
+    g_nvs.scrub_cursor = (bad + 1) % NVS_MAX_KEYS;
+
+    int partial = 1;
+    for (int i = 1; i < live; i++) {
+        uint32_t cursor = g_nvs.scrub_cursor;
+        if (nvs_scrub(1) != 0 || g_nvs.scrub_cursor == cursor) partial = 0;
+    }
+    TEST_ASSERT(live > 1 && partial && g_corrupt_reports == 2, "Small budget scans only part of the keys");
+
+    ret = nvs_scrub(1);
+    TEST_ASSERT(ret == 1 && g_corrupt_reports == 3, "Next scrub resumes where the cursor stopped");
+
+    // 重新写入后恢复正常
+    ret = nvs_set("boot_mode", "normal", strlen("normal"));
+    memset(buf, 0, sizeof(buf));
+    ret = nvs_get("boot_mode", buf, sizeof(buf));
+    TEST_ASSERT(ret > 0 && strcmp(buf, "normal") == 0, "Rewrite repairs corrupted key");
+
+    nvs_set_corrupt_callback(NULL);
+}
+
+typedef struct {
+    uint8_t buf[4096];
+    size_t len;
+    size_t pos;
+} mem_stream_t;
+
+static int mem_write(const void *buf, size_t len, void *ctx) {
+    mem_stream_t *s = (mem_stream_t *)ctx;
+    if (s->len + len > sizeof(s->buf)) return -1;
+    memcpy(s->buf + s->len, buf, len);
+    s->len += len;
+    return 0;
+}
+
+static int mem_read(void *buf, size_t len, void *ctx) {
+    mem_stream_t *s = (mem_stream_t *)ctx;
+    if (s->pos + len > s->len) return -1;
+    memcpy(buf, s->buf + s->pos, len);
+    s->pos += len;
+    return 0;
+}
+
+void test_snapshot(void) {
+    printf("\n=== Test 7: Snapshot Export / Import ===\n");
+
+    static mem_stream_t stream;
+    char buf[64];
+    int ret;
+
+    memset(&stream, 0, sizeof(stream));
+    ret = nvs_export(mem_write, &stream);
+    TEST_ASSERT(ret > 0, "Export all live keys");
+    int exported = ret;
+
+    // 导出之后修改数据
+    nvs_set("wifi_ssid", "ChangedWiFi", strlen("ChangedWiFi"));
+    nvs_set("tmp_key", "tmp", 3);
+
+    // 损坏的流: 导入失败，原数据不受影响
+    static mem_stream_t bad;
+    bad = stream;
+    bad.buf[bad.len - 1] ^= 0xFF;
+    ret = nvs_import(mem_read, &bad);
+    memset(buf, 0, sizeof(buf));
+    nvs_get("wifi_ssid", buf, sizeof(buf));
+    TEST_ASSERT(ret < 0 && strcmp(buf, "ChangedWiFi") == 0, "Corrupted snapshot rejected, store untouched");
+
+    // 正常导入: 恢复到导出时的状态
+    ret = nvs_import(mem_read, &stream);
+    TEST_ASSERT(ret == exported, "Import snapshot");
+
+    memset(buf, 0, sizeof(buf));
+    ret = nvs_get("wifi_ssid", buf, sizeof(buf));
+    TEST_ASSERT(ret > 0 && strcmp(buf, "OfficeWiFi") == 0, "Imported value restored");
+    TEST_ASSERT(nvs_get("tmp_key", buf, sizeof(buf)) == -1, "Keys added after export are gone");
+
+    TEST_ASSERT(nvs_init() == 0, "Re-Init after import");
+    memset(buf, 0, sizeof(buf));
+    ret = nvs_get("sensor_temperature_reading", buf, sizeof(buf));
+    TEST_ASSERT(ret == sizeof(uint32_t) && buf[0] == 2, "Imported data persists after reboot");
+}
+
+void test_writeback(void) {
+    printf("\n=== Test 8: Write-Back Coalescing ===\n");
+
+    nvs_stats_t stats;
+    uint32_t val;
+    uint32_t buf = 0;
+    int ret;
+
+    nvs_poll(1000);
+    ret = nvs_writeback_enable("imu_sample", 100);
+    TEST_ASSERT(ret == 0, "Enable write-back for 'imu_sample'");
+
+    nvs_reset_stats();
+    uint32_t before = g_nvs.write_offset;
+
+    for (val = 1; val <= 50; val++) {
+        nvs_set("imu_sample", &val, sizeof(val));
+    }
+    TEST_ASSERT(g_nvs.write_offset == before, "Buffered updates do not touch flash");
+
+    ret = nvs_get("imu_sample", &buf, sizeof(buf));
+    TEST_ASSERT(ret == sizeof(buf) && buf == 50, "Get returns buffered value");
+
+    // 期限未到，不落盘
+    nvs_poll(1050);
+    TEST_ASSERT(g_nvs.write_offset == before, "No flush before deadline");
+
+    // 到期后只写一条
+    nvs_poll(1100);
+    nvs_get_stats(&stats);
+    TEST_ASSERT(stats.wb_flushes == 1 && stats.write_count == 1 && stats.coalesced_writes == 49,
+                "Deadline flushes one coalesced entry");
+
+    // 绕过缓冲，确认 Flash 里就是最新值
+    TEST_ASSERT(nvs_init() == 0, "Re-Init after flush");
+    buf = 0;
+    ret = nvs_get("imu_sample", &buf, sizeof(buf));
+    TEST_ASSERT(ret == sizeof(buf) && buf == 50, "Flushed value persists");
+
+    val = 51;
+    nvs_set("imu_sample", &val, sizeof(val));
+    TEST_ASSERT(nvs_flush() == 0 && nvs_writeback_disable("imu_sample") == 0, "Explicit flush");
+    buf = 0;
+    ret = nvs_get("imu_sample", &buf, sizeof(buf));
+    TEST_ASSERT(ret == sizeof(buf) && buf == 51, "Explicitly flushed value readable");
+
+    // 待写数据量达到 NVS_WB_FLUSH_BYTES 时不等期限，立即整体落盘
+    // 一条 250 字节的条目不到阈值，两条超过阈值
+    uint8_t blob[250];
+    memset(blob, 0xA5, sizeof(blob));
+    nvs_writeback_enable("wb_blob_a", 10000);
+    nvs_writeback_enable("wb_blob_b", 10000);
+    nvs_reset_stats();
+    before = g_nvs.write_offset;
+
+    nvs_set("wb_blob_a", blob, sizeof(blob));
+    blob[0]++;
+    nvs_set("wb_blob_a", blob, sizeof(blob));
+    TEST_ASSERT(g_nvs.write_offset == before, "Coalesced updates below threshold stay buffered");
+
+    nvs_set("wb_blob_b", blob, sizeof(blob));
+    nvs_get_stats(&stats);
+    TEST_ASSERT(stats.wb_flushes == 1 && stats.write_count == 2 && g_nvs.write_offset > before,
+                "Reaching the byte threshold flushes the batch");
+    TEST_ASSERT(nvs_writeback_disable("wb_blob_a") == 0 && nvs_writeback_disable("wb_blob_b") == 0,
+                "Disable after threshold flush");
+}
+
+void test_static_wl(void) {
+    printf("\n=== Test 9: Static Wear Leveling ===\n");
+
+    char buf[64];
+    int ret;
+    int old_idx = -1;
+
+    // 模拟偏斜: 所有空闲扇区已经被磨损了很多次，活动扇区里是长期不动的冷数据
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        uint32_t addr = nvs_sector_addr(i);
+        if (addr == g_nvs.active_sector_addr) {
+            old_idx = i;
+            continue;
+        }
+
+        nvs_sector_header_t header = { NVS_SECTOR_MAGIC(g_nvs.device_count), 50, SECTOR_STATE_EMPTY, NVS_FREE_SEQ_ID };
+        hal_flash_erase(addr);
+        hal_flash_write(addr, &header, sizeof(header));
+    }
+    TEST_ASSERT(nvs_init() == 0 && g_nvs.sector_erase_counts[(old_idx + 1) % NVS_SECTOR_COUNT] == 50,
+                "Erase counts of free sectors survive reboot");
+
+    uint32_t cold_count = g_nvs.sector_erase_counts[old_idx];
+
+    // 刚挂载时还不能确定是冷数据
+    for (int i = 0; i < NVS_STATIC_WL_COLD_CHECKS; i++) {
+        ret = nvs_static_wl_step(NVS_SECTOR_SIZE);
+        if (ret != 0) break;
+    }
+    TEST_ASSERT(ret == 0, "No migration until sector proves cold");
+
+    // 预算不够时推迟
+    ret = nvs_static_wl_step(0);
+    TEST_ASSERT(ret == 0 && g_nvs.active_sector_addr == nvs_sector_addr(old_idx), "Migration deferred by budget");
+
+    ret = nvs_static_wl_step(NVS_SECTOR_SIZE);
+    TEST_ASSERT(ret == 1 && g_nvs.sector_erase_counts[get_active_idx()] == 50, "Cold data migrated to least worn free sector");
+
+    // 低磨损扇区已经空出来，不需要再搬
+    ret = nvs_static_wl_step(NVS_SECTOR_SIZE);
+    TEST_ASSERT(ret == 0, "No repeated migration");
+
+    TEST_ASSERT(nvs_init() == 0 && g_nvs.sector_erase_counts[old_idx] == cold_count + 1,
+                "Freed sector keeps its erase count after reboot");
+
+    memset(buf, 0, sizeof(buf));
+    ret = nvs_get("wifi_ssid", buf, sizeof(buf));
+    TEST_ASSERT(ret > 0 && strcmp(buf, "OfficeWiFi") == 0, "Data intact after migration");
+}
+
+void test_multi_device(void) {
+    printf("\n=== Test 10: Striping Across Two Flash Devices ===\n");
+
+    char key[16];
+    char val[32];
+    char buf[64];
+    int ret;
+
+    // 第二片 Flash 从空白开始；扇区布局改变后原来的数据不再有效，先清掉
+    remove("flash_mock_1.bin");
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        hal_flash_erase(NVS_BASE_ADDR + i * NVS_SECTOR_SIZE);
+    }
+
+    ret = hal_flash_add_device("flash_mock_1.bin");
+    TEST_ASSERT(ret == 1, "Add second flash device");
+    TEST_ASSERT(nvs_init() == 0 && g_nvs.device_count == 2, "Init NVS on two devices");
+
+    // 相邻扇区在不同器件上
+    TEST_ASSERT(HAL_FLASH_ADDR_DEV(nvs_sector_addr(0)) == 0 && HAL_FLASH_ADDR_DEV(nvs_sector_addr(1)) == 1,
+                "Sectors are striped round-robin");
+
+    // 每次 GC 都应该换到另一片 Flash 上
+    nvs_stats_t stats;
+    int switches = 0;
+    nvs_reset_stats();
+    uint32_t last_dev = HAL_FLASH_ADDR_DEV(g_nvs.active_sector_addr);
+
+    for (int i = 0; i < 400; i++) {
+        sprintf(key, "k%d", i % 20);
+        sprintf(val, "stripe_data_%d", i);
+
+        ret = nvs_set(key, val, strlen(val));
+        if (ret != 0) {
+            printf("[FAIL] Write failed at iteration %d with error %d\n", i, ret);
+            return;
+        }
+
+        uint32_t dev = HAL_FLASH_ADDR_DEV(g_nvs.active_sector_addr);
+        if (dev != last_dev) switches++;
+        last_dev = dev;
+    }
+    nvs_get_stats(&stats);
+    TEST_ASSERT(stats.gc_count >= 2 && switches == (int)stats.gc_count, "GC copies from one device to the other");
+
+    // 另一片上的扇区磨损得多 (只改 RAM 里的计数，Flash 上的头部不变，重启后恢复):
+    // 静态均衡放弃跨器件优先，GC 留在低磨损的这一片上
+    last_dev = HAL_FLASH_ADDR_DEV(g_nvs.active_sector_addr);
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        if (HAL_FLASH_ADDR_DEV(nvs_sector_addr(i)) != last_dev) g_nvs.sector_erase_counts[i] += 100;
+    }
+    nvs_set_static_wl(1);
+    TEST_ASSERT(nvs_execute_gc() == 0 && HAL_FLASH_ADDR_DEV(g_nvs.active_sector_addr) == last_dev,
+                "Skewed wear keeps GC on the less worn device");
+
+    TEST_ASSERT(nvs_init() == 0, "Re-Init on two devices");
+    memset(buf, 0, sizeof(buf));
+    ret = nvs_get("k19", buf, sizeof(buf));
+    TEST_ASSERT(ret > 0 && strcmp(buf, "stripe_data_399") == 0, "Data persists across devices after reboot");
+
+    // 少了一片 Flash: 扇区布局对不上，拒绝挂载，也不能改动 Flash
+    uint32_t seq_id = g_nvs.current_seq_id;
+    hal_flash_init();
+    TEST_ASSERT(nvs_init() == -2, "Mount refused after device count changed");
+
+    hal_flash_add_device("flash_mock_1.bin");
+    TEST_ASSERT(nvs_init() == 0 && g_nvs.current_seq_id == seq_id, "Original layout mounts untouched");
+    memset(buf, 0, sizeof(buf));
+    ret = nvs_get("k19", buf, sizeof(buf));
+    TEST_ASSERT(ret > 0 && strcmp(buf, "stripe_data_399") == 0, "Data intact after refused mount");
+
+    // 跨器件 GC 后不等 nvs_poll 就重启: 旧扇区的空闲头部还没写，擦除次数不能丢
+    // (关掉静态均衡，GC 一定跨器件)
+    nvs_set_static_wl(0);
+    int src_idx = get_active_idx();
+    TEST_ASSERT(nvs_execute_gc() == 0 && g_nvs.stamp_pending, "Cross-device GC defers free-sector header");
+
+    uint32_t src_count = g_nvs.sector_erase_counts[src_idx];
+    TEST_ASSERT(nvs_init() == 0 && g_nvs.sector_erase_counts[src_idx] >= src_count,
+                "Erase count of unstamped sector survives reboot");
+
+    // 每次 GC 后都马上重启: 计数丢了的话旧扇区看起来最新，GC 会一直在两个扇区之间来回
+    int kept = 1;
+    for (int i = 0; i < 2 * NVS_SECTOR_COUNT; i++) {
+        uint32_t counts[NVS_SECTOR_COUNT];
+
+        nvs_execute_gc();
+        memcpy(counts, g_nvs.sector_erase_counts, sizeof(counts));
+        nvs_init();
+        for (int j = 0; j < NVS_SECTOR_COUNT; j++) {
+            if (g_nvs.sector_erase_counts[j] < counts[j]) kept = 0;
+        }
+    }
+    TEST_ASSERT(kept, "Erase counts survive repeated GC + reboot without poll");
+    nvs_set_static_wl(1);
+}
+
+void test_read_cache(void) {
+    printf("\n=== Test 11: Page Read Cache ===\n");
+
+    static uint8_t cached[NVS_SECTOR_SIZE];
+    static uint8_t raw[NVS_SECTOR_SIZE];
+    hal_cache_stats_t stats;
+
+    // 写穿透 + 擦除失效之后，缓存看到的内容必须和 Flash 完全一致
+    nvs_set("cache_probe", "before_gc", strlen("before_gc"));
+    nvs_execute_gc();
+    nvs_set("cache_probe", "after_gc", strlen("after_gc"));
+
+    hal_cache_read(g_nvs.active_sector_addr, cached, sizeof(cached));
+    hal_flash_read(g_nvs.active_sector_addr, raw, sizeof(raw));
+    TEST_ASSERT(memcmp(cached, raw, sizeof(raw)) == 0, "Cache coherent with flash after writes and erase");
+
+    // 挂载扫描被合并成少量整页读取
+    hal_cache_reset_stats();
+    TEST_ASSERT(nvs_init() == 0, "Re-Init with cache");
+    hal_cache_get_stats(&stats);
+    printf("  -> mount: %d reads -> %d HAL reads\n", stats.reads, stats.hal_reads);
+    TEST_ASSERT(stats.hal_reads <= NVS_SECTOR_COUNT + NVS_SECTOR_SIZE / FLASH_PAGE_SIZE && stats.hal_reads < stats.reads / 4,
+                "Mount scan uses few large reads");
+
+    char buf[32];
+    memset(buf, 0, sizeof(buf));
+    int ret = nvs_get("cache_probe", buf, sizeof(buf));
+    TEST_ASSERT(ret > 0 && strcmp(buf, "after_gc") == 0, "Read through cache after reboot");
+}
+
+void test_counter(void) {
+    printf("\n=== Test 12: Bit-Clearing Counters ===\n");
+
+    uint32_t value = 0;
+    nvs_stats_t before, after;
+    int ok = 1;
+
+    nvs_get_stats(&before);
+    for (uint32_t i = 1; i <= 1000; i++) {
+        if (nvs_counter_inc("boot_count", &value) != 0 || value != i) ok = 0;
+    }
+    nvs_get_stats(&after);
+    TEST_ASSERT(ok, "1000 increments return consecutive values");
+    TEST_ASSERT(after.write_count - before.write_count == 2 && after.counter_bit_clears - before.counter_bit_clears == 998,
+                "Only a new base entry per exhausted bitmap");
+
+    TEST_ASSERT(nvs_init() == 0, "Re-Init");
+    TEST_ASSERT(nvs_counter_get("boot_count", &value) == 0 && value == 1000, "Counter survives reboot");
+
+    // GC 把计数器折叠成新基数，之后的加一还是原地清位
+    nvs_execute_gc();
+    nvs_get_stats(&before);
+    nvs_counter_inc("boot_count", &value);
+    nvs_get_stats(&after);
+    TEST_ASSERT(value == 1001 && after.write_count == before.write_count, "Counter folded by GC keeps counting in place");
+
+    uint32_t raw = 0;
+    TEST_ASSERT(nvs_get("boot_count", &raw, sizeof(raw)) == sizeof(raw) && raw == 1001, "nvs_get reads counter value");
+
+    // 和基数字节相同的普通值不能被当成重复写入
+    nvs_counter_inc("event_count", NULL);
+    nvs_counter_inc("event_count", NULL);
+    raw = 1;
+    nvs_set("event_count", &raw, sizeof(raw));
+    raw = 0;
+    nvs_get("event_count", &raw, sizeof(raw));
+    TEST_ASSERT(raw == 1, "Plain set over counter is not suppressed");
+    TEST_ASSERT(nvs_counter_inc("event_count", NULL) == -5, "Increment rejects non-counter key");
+
+    // 快照导出折叠后的计数值
+    static mem_stream_t stream;
+    memset(&stream, 0, sizeof(stream));
+    TEST_ASSERT(nvs_export(mem_write, &stream) > 0, "Export with counter");
+    nvs_counter_inc("boot_count", NULL);
+    TEST_ASSERT(nvs_import(mem_read, &stream) > 0, "Import with counter");
+    TEST_ASSERT(nvs_counter_get("boot_count", &value) == 0 && value == 1001, "Counter restored from snapshot");
+    TEST_ASSERT(nvs_counter_inc("boot_count", &value) == 0 && value == 1002, "Restored counter keeps counting");
+
+    // 位图只能从字节 0 的最低位开始连续清 0
+    uint8_t bits[NVS_COUNTER_DATA_LEN];
+    memset(bits, 0xFF, sizeof(bits));
+    memset(bits, 0, sizeof(uint32_t));
+    bits[4] = 0x00;
+    bits[5] = 0xF8;
+    TEST_ASSERT(nvs_counter_value(bits, &value) == 0 && value == 11, "Contiguous bitmap decodes");
+    bits[7] = 0xFE;
+    TEST_ASSERT(nvs_counter_value(bits, &value) == -2, "Bitmap with a hole is rejected");
+
+    // 位图不在 CRC 里: Flash 上清掉一个不连续的位，读取和巡检都要把它当成损坏
+    nvs_index_node_t *node = nvs_index_lookup("boot_count");
+    uint32_t bitmap_addr = g_nvs.active_sector_addr + node->offset + sizeof(nvs_entry_header_t) + node->key_len + sizeof(uint32_t);
+    uint8_t flipped = 0xF6;         // 当前是 0xFE，再清掉 bit 3
+    hal_flash_write(bitmap_addr, &flipped, 1);
+    TEST_ASSERT(nvs_counter_get("boot_count", &value) == -2, "Bit flip in counter bitmap detected on read");
+
+    g_nvs.scrub_cursor = node - g_nvs.node_pool;
+    TEST_ASSERT(nvs_scrub(1) == 1, "Scrub reports corrupted counter bitmap");
+    nvs_delete(g_nvs.active_sector_addr, "boot_count");
+}
+
+void test_flash_timing(void) {
+    printf("\n=== Test 13: Flash Timing Model ===\n");
+
+    hal_flash_timing_t timing = { 1000, 10, 5000, 100000, 0, 1, 0, 500 };
+    uint32_t scratch = HAL_FLASH_ADDR(0, 0x10000);      // NVS 管理范围之外的扇区
+    uint32_t other = scratch + FLASH_SECTOR_SIZE;
+    uint8_t buf[16];
+    uint64_t t0;
+
+    hal_flash_set_timing(&timing);
+
+    t0 = hal_flash_now_ns();
+    hal_flash_read(other, buf, sizeof(buf));
+    TEST_ASSERT(hal_flash_now_ns() - t0 == 1000 + 10 * sizeof(buf), "Read costs setup + per byte");
+
+    memset(buf, 0x5A, sizeof(buf));
+    t0 = hal_flash_now_ns();
+    hal_flash_write(other + FLASH_PAGE_SIZE - 4, buf, 8);
+    TEST_ASSERT(hal_flash_now_ns() - t0 == 2 * 5000, "Program costs per page touched");
+
+    // 忙等: 擦除期间访问同一片 Flash 要等到擦除结束
+    uint64_t wait0 = hal_flash_get_wait_ns();
+    t0 = hal_flash_now_ns();
+    hal_flash_erase_start(scratch);
+    hal_flash_advance_ns(30000);
+    hal_flash_read(other, buf, 4);
+    TEST_ASSERT(hal_flash_now_ns() - t0 == 100000 + 1040 && hal_flash_get_wait_ns() - wait0 == 70000,
+                "Access during erase busy-waits for the rest of it");
+
+    // 擦除暂停: 访问只付暂停开销，擦除结束时间往后顺延
+    timing.erase_suspend = 1;
+    hal_flash_set_timing(&timing);
+    t0 = hal_flash_now_ns();
+    hal_flash_erase_start(scratch);
+    hal_flash_read(other, buf, 4);
+    TEST_ASSERT(hal_flash_now_ns() - t0 == 500 + 1040, "Erase suspend serves access immediately");
+    hal_flash_sync(0);
+    TEST_ASSERT(hal_flash_now_ns() - t0 == 100000 + 500 + 1040, "Suspended erase finishes later");
+
+    // 抖动: 同一个种子得到同样的序列
+    timing.erase_suspend = 0;
+    timing.jitter_pct = 20;
+    timing.jitter_seed = 7;
+    uint64_t first[4], second[4];
+    int in_range = 1;
+    for (int run = 0; run < 2; run++) {
+        hal_flash_set_timing(&timing);
+        for (int i = 0; i < 4; i++) {
+            t0 = hal_flash_now_ns();
+            hal_flash_erase(scratch);
+            uint64_t cost = hal_flash_now_ns() - t0;
+            if (cost < 80000 || cost > 120000) in_range = 0;
+            if (run == 0) first[i] = cost; else second[i] = cost;
+        }
+    }
+    TEST_ASSERT(in_range && memcmp(first, second, sizeof(first)) == 0, "Jitter is bounded and deterministic");
+
+    hal_flash_set_timing(NULL);
+    t0 = hal_flash_now_ns();
+    hal_flash_erase(scratch);
+    TEST_ASSERT(hal_flash_now_ns() == t0, "Timing model off by default");
+}
+
+// 和 nvs_image keygen 生成的常量格式相同
+static const nvs_key_t k_handle_key = NVS_KEY_CONST("handle_key", 0x18613939u);
+
+void test_key_handle(void) {
+    printf("\n=== Test 14: Key Handles ===\n");
+
+    nvs_key_t runtime_key;
+    char buf[32];
+    int ret;
+
+    TEST_ASSERT(nvs_key_init(&runtime_key, "handle_key") == 0 && runtime_key.hash == k_handle_key.hash &&
+                runtime_key.len == k_handle_key.len, "Runtime handle matches generated constant");
+
+    ret = nvs_set_by_handle(&k_handle_key, "first", strlen("first"));
+    memset(buf, 0, sizeof(buf));
+    nvs_get("handle_key", buf, sizeof(buf));
+    TEST_ASSERT(ret == 0 && strcmp(buf, "first") == 0, "Set by handle, get by name");
+
+    nvs_set("handle_key", "second", strlen("second"));
+    memset(buf, 0, sizeof(buf));
+    ret = nvs_get_by_handle(&runtime_key, buf, sizeof(buf));
+    TEST_ASSERT(ret == (int)strlen("second") && strcmp(buf, "second") == 0, "Set by name, get by handle");
+
+    // 句柄写入同样经过重复写入抑制和写回缓冲
+    nvs_stats_t before, after;
+    nvs_get_stats(&before);
+    nvs_set_by_handle(&k_handle_key, "second", strlen("second"));
+    nvs_get_stats(&after);
+    TEST_ASSERT(after.suppressed_writes == before.suppressed_writes + 1, "Unchanged value suppressed by handle");
+
+    nvs_writeback_enable("handle_key", 100);
+    nvs_set_by_handle(&k_handle_key, "third", strlen("third"));
+    memset(buf, 0, sizeof(buf));
+    nvs_get_by_handle(&k_handle_key, buf, sizeof(buf));
+    TEST_ASSERT(strcmp(buf, "third") == 0, "Handle reads buffered value");
+    nvs_writeback_disable("handle_key");
+
+    TEST_ASSERT(nvs_delete_by_handle(g_nvs.active_sector_addr, &k_handle_key) == 0, "Delete by handle");
+    TEST_ASSERT(nvs_get("handle_key", buf, sizeof(buf)) == -1, "Deleted key is gone");
+
+    char long_key[NVS_KEY_MAX_LEN + 2];
+    memset(long_key, 'k', sizeof(long_key) - 1);
+    long_key[sizeof(long_key) - 1] = '\0';
+    TEST_ASSERT(nvs_key_init(&runtime_key, long_key) == -2, "Too long key rejected");
+}
+
 int main(void) {
     // 1. 初始化硬件 Mock (生成 bin 文件)
     if (hal_flash_init() != 0) {
@@ -108,7 +735,12 @@ int main(void) {
     }
 
     // 2. 初始化 NVS
-    if (nvs_init() != 0) {
+    //    上一次运行结束时是两片 Flash 的布局，单片挂载会被拒绝；演示程序不需要旧数据，重新格式化
+    int ret = nvs_init();
+    if (ret == -2) {
+        ret = nvs_format_all();
+    }
+    if (ret != 0) {
         printf("NVS init failed!\n");
         return -1;
     }
@@ -118,6 +750,17 @@ int main(void) {
     test_basic_rw();
     test_reboot_recovery();
     test_stress_gc(); // 这个测试会在控制台打印 GC 的过程
+    test_key_dict();
+    test_redundant_write();
+    test_verify_policy();
+    test_snapshot();
+    test_writeback();
+    test_static_wl();
+    test_multi_device();
+    test_read_cache();
+    test_counter();
+    test_flash_timing();
+    test_key_handle();
 
     printf("\nAll Tests Finished.\n");
     return 0;
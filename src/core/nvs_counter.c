@@ -0,0 +1,127 @@
+#include <string.h>
+#include "hal_flash_cache.h"
+#include "tinynvs.h"
+#include "crc32.h"
+
+// 读出计数器条目的基数和位图，校验 Key + 基数的 CRC 和位图的形状
+// data_addr 返回 payload 里 data 部分的绝对地址 (原地清位用)，value 返回当前计数值
+static int counter_load(const nvs_index_node_t *node, uint8_t *data, uint32_t *data_addr, uint32_t *value) {
+    uint32_t addr = g_nvs.active_sector_addr + node->offset;
+    nvs_entry_header_t header;
+    uint8_t key_buf[NVS_KEY_MAX_LEN];
+
+    hal_flash_read(addr, &header, sizeof(header));
+    if (header.state != ENTRY_STATE_VALID || header.type != ENTRY_TYPE_COUNTER ||
+        header.key_len > NVS_KEY_MAX_LEN || header.data_len != NVS_COUNTER_DATA_LEN) {
+        return -2;
+    }
+
+    *data_addr = addr + sizeof(header) + header.key_len;
+    hal_flash_read(addr + sizeof(header), key_buf, header.key_len);
+    hal_flash_read(*data_addr, data, NVS_COUNTER_DATA_LEN);
+
+    uint32_t crc = crc32_init();
+    crc = crc32_update(crc, key_buf, header.key_len);
+    crc = crc32_update(crc, data, sizeof(uint32_t));
+    if (crc32_final(crc) != header.crc || nvs_counter_value(data, value) != 0) {
+        g_nvs.stats.corrupt_count++;
+        printf("[NVS] Corrupted counter at offset %d (hash 0x%08X)\n", node->offset, node->key_hash);
+        return -2;
+    }
+    return 0;
+}
+
+// 追加一条新的基数条目，扇区满了先 GC 再重试
+static int counter_append(const char *key, uint8_t key_len, uint32_t base) {
+    uint32_t item_offset = g_nvs.write_offset;
+    int next_offset = nvs_append_counter(g_nvs.active_sector_addr, item_offset, key, key_len, base);
+
+    if (next_offset < 0) {
+        printf("[NVS] Sector full, triggering GC...\n");
+
+        if (nvs_execute_gc() != 0) {
+            printf("[NVS] GC Failed! Flash might be full or broken.\n");
+            return -3;
+        }
+
+        item_offset = g_nvs.write_offset;
+        next_offset = nvs_append_counter(g_nvs.active_sector_addr, item_offset, key, key_len, base);
+        if (next_offset < 0) {
+            printf("[NVS] Error: Storage full even after GC!\n");
+            return -4;
+        }
+    }
+
+    nvs_index_node_t *node = nvs_index_update(key, item_offset);
+    if (node) {
+        node->key_id = NVS_KEY_ID_NONE;
+        node->key_len = key_len;
+        node->data_len = NVS_COUNTER_DATA_LEN;
+        node->crc = crc32_final(crc32_update(crc32_update(crc32_init(), key, key_len), &base, sizeof(base)));
+        node->type = ENTRY_TYPE_COUNTER;
+    }
+
+    g_nvs.stats.write_count++;
+    g_nvs.stats.write_bytes += (uint32_t)next_offset - item_offset;
+    g_nvs.write_offset = (uint32_t)next_offset;
+
+    return 0;
+}
+
+// 计数器加一，value 不为 NULL 时返回加一之后的值
+// 通常只是把位图里的一个位原地清 0；Key 不存在或位图用完时才追加新条目
+// 返回 0 成功，-1 参数错误，-2 Flash 错误或条目损坏，-3/-4 同 nvs_set，-5 Key 存的不是计数器
+int nvs_counter_inc(const char *key, uint32_t *value) {
+    if (key == NULL || strlen(key) == 0) return -1;
+    if (strlen(key) > NVS_KEY_MAX_LEN) return -2;
+
+    nvs_index_node_t *node = nvs_index_lookup(key);
+    uint32_t current = 0;
+
+    if (node != NULL && node->offset != 0) {
+        if (node->type != ENTRY_TYPE_COUNTER) return -5;
+
+        uint8_t data[NVS_COUNTER_DATA_LEN];
+        uint32_t data_addr;
+        int ret = counter_load(node, data, &data_addr, &current);
+        if (ret != 0) return ret;
+
+        // 找到第一个还有 1 的位图字节，把它最低的那个 1 清掉
+        for (uint32_t i = sizeof(uint32_t); i < NVS_COUNTER_DATA_LEN; i++) {
+            if (data[i] == 0x00) continue;
+
+            uint8_t cleared = data[i] & (uint8_t)(data[i] - 1);
+            if (hal_cache_write(data_addr + i, &cleared, 1) != 0) return -2;
+
+            g_nvs.stats.counter_bit_clears++;
+            if (value) *value = current + 1;
+            return 0;
+        }
+    }
+
+    int ret = counter_append(key, strlen(key), current + 1);
+    if (ret != 0) return ret;
+
+    if (value) *value = current + 1;
+    return 0;
+}
+
+// 读取计数器当前值
+// 返回 0 成功，-1 Key 不存在，-2 条目损坏，-5 Key 存的不是计数器
+int nvs_counter_get(const char *key, uint32_t *value) {
+    if (key == NULL || value == NULL) return -1;
+
+    nvs_index_node_t *node = nvs_index_lookup(key);
+    if (node == NULL || node->offset == 0) return -1;
+    if (node->type != ENTRY_TYPE_COUNTER) return -5;
+
+    return nvs_counter_read(node, value);
+}
+
+// 从已经查到的索引节点读取计数值 (nvs_get 读计数器时用)
+int nvs_counter_read(const nvs_index_node_t *node, uint32_t *value) {
+    uint8_t data[NVS_COUNTER_DATA_LEN];
+    uint32_t data_addr;
+
+    return counter_load(node, data, &data_addr, value);
+}
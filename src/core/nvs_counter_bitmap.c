@@ -0,0 +1,38 @@
+#include <string.h>
+#include "tinynvs.h"
+
+// 计数器 data 部分的解码 (不依赖 HAL 和 g_nvs，离线镜像工具也链接这个文件)
+//
+// 位图不在 CRC 覆盖范围内 (它会被原地清位)，所以位翻转不会被 CRC 发现。
+// 能兜底的只有格式本身: 加一总是从字节 0 的最低位开始往上依次清 0，
+// 合法的位图按 "字节 0 低位在前" 的顺序读出来只能是 0...01...1 这种形状，
+// 出现空洞 (某个 0 的前面还有 1) 说明位图被破坏了，按条目损坏处理
+
+// 计数值 = 基数 + 位图里已经清成 0 的位数
+// 返回 0 成功，-2 位图不连续 (条目损坏)
+int nvs_counter_value(const void *data, uint32_t *value) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t count;
+    int tail = 0;
+
+    memcpy(&count, p, sizeof(count));
+    for (uint32_t i = sizeof(count); i < NVS_COUNTER_DATA_LEN; i++) {
+        // 已经遇到过还有 1 的字节，后面只能全是 1
+        if (tail) {
+            if (p[i] != 0xFF) return -2;
+            continue;
+        }
+
+        // 清掉的位必须是从最低位开始的连续一段: ~b 形如 0...01...1
+        uint8_t cleared = (uint8_t)~p[i];
+        if (cleared & (cleared + 1)) return -2;
+
+        for (; cleared; cleared >>= 1) {
+            count++;
+        }
+        if (p[i] != 0x00) tail = 1;
+    }
+
+    *value = count;
+    return 0;
+}
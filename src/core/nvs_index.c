@@ -2,7 +2,7 @@
 #include <string.h>
 #include "tinynvs.h"
 #include "crc32.h"
-#include "hal_flash.h"
+#include "hal_flash_cache.h"
 
 static nvs_index_node_t *buckets[NVS_BUCKET_SIZE] = {NULL};
 
@@ -21,8 +21,7 @@ static uint8_t get_bucket_idx(uint32_t hash) {
     return hash % NVS_BUCKET_SIZE;
 }
 
-void nvs_index_update(const char *key, uint32_t offset) {
-    uint32_t hash = crc32_compute(key, strlen(key));
+nvs_index_node_t *nvs_index_update_hash(uint32_t hash, uint32_t offset) {
     uint8_t idx = get_bucket_idx(hash);
 
     // A. 查找是否存在 (覆盖旧数据的 offset)
@@ -30,7 +29,7 @@ void nvs_index_update(const char *key, uint32_t offset) {
     while (node) {
         if(node->key_hash == hash) {
             node->offset = offset;
-            return;
+            return node;
         }
         node = node->next;
     }
@@ -40,48 +39,156 @@ void nvs_index_update(const char *key, uint32_t offset) {
     if (new_node) {
         new_node->key_hash = hash;
         new_node->offset = offset;
+        new_node->key_id = NVS_KEY_ID_NONE;
+        new_node->type = ENTRY_TYPE_DATA;
         new_node->next = buckets[idx];          // 插入链表头
         buckets[idx] = new_node;                // 把new_node作为buckets的头节点
     }
     else {
         printf("too many keys\n");
     }
+    return new_node;
 }
- 
-uint32_t nvs_index_find(const char *key) {
-    uint32_t hash = crc32_compute(key, strlen(key));
-    uint8_t idx = get_bucket_idx(hash);
 
-    nvs_index_node_t *node = buckets[idx];
+nvs_index_node_t *nvs_index_lookup_hash(uint32_t hash) {
+    nvs_index_node_t *node = buckets[get_bucket_idx(hash)];
     while (node) {
         if (node->key_hash == hash) {
-            return node->offset;
+            return node;
         }
         node = node->next;
     }
+    return NULL;
+}
+
+void nvs_index_remove_hash(uint32_t hash) {
+    uint8_t idx = get_bucket_idx(hash);
+
+    nvs_index_node_t *current = buckets[idx];
+    nvs_index_node_t *prev = NULL;
+
+    while (current) {
+        if (current->key_hash == hash) {
+            if (prev == NULL) {
+                buckets[idx] = current->next;
+            }
+            else {
+                prev->next = current->next;
+            }
+
+            // Key 被删除后，它的字典 ID 也一并释放，可以分配给新 Key
+            if (current->key_id != NVS_KEY_ID_NONE) {
+                g_nvs.key_dict[current->key_id].offset = 0;
+            }
+            current->used = 0;
+            return;
+        }
+        prev = current;
+        current = current->next;
+    }
+}
+
+// 预先算好 Key 的哈希和长度，之后的 *_by_handle 接口不用再算
+// 返回 0 成功，-1 参数错误，-2 Key 太长
+int nvs_key_init(nvs_key_t *handle, const char *key) {
+    if (handle == NULL || key == NULL) return -1;
+
+    size_t len = strlen(key);
+    if (len > NVS_KEY_MAX_LEN) return -2;
+
+    handle->name = key;
+    handle->hash = crc32_compute(key, len);
+    handle->len = (uint8_t)len;
     return 0;
 }
 
+nvs_index_node_t *nvs_index_update(const char *key, uint32_t offset) {
+    uint32_t hash = crc32_compute(key, strlen(key));
+    return nvs_index_update_hash(hash, offset);
+}
+
+// 分配一个空闲的字典 ID (offset 为 0 的槽位)
+uint16_t nvs_dict_alloc_id(void) {
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        if (g_nvs.key_dict[i].offset == 0) {
+            return (uint16_t)i;
+        }
+    }
+    return NVS_KEY_ID_NONE;
+}
+
+void nvs_dict_bind(uint16_t key_id, uint32_t key_hash, uint32_t def_offset) {
+    if (key_id >= NVS_MAX_KEYS) return;
+
+    g_nvs.key_dict[key_id].key_hash = key_hash;
+    g_nvs.key_dict[key_id].offset = def_offset;
+}
+
+// 挂载时遇到字典定义条目
+// ID 只有在旧 Key 被删除后才会被复用，所以如果这个 ID 之前绑定的是别的 Key，
+// 说明那个 Key 已经被删除了，它残留的旧条目也要从索引里去掉
+static void dict_mount_def(uint16_t key_id, const char *key, uint32_t def_offset) {
+    if (key_id >= NVS_MAX_KEYS) return;
+
+    nvs_key_dict_t *slot = &g_nvs.key_dict[key_id];
+    uint32_t hash = crc32_compute(key, strlen(key));
+
+    if (slot->offset != 0 && slot->key_hash != hash) {
+        nvs_index_node_t *old = nvs_index_lookup_hash(slot->key_hash);
+        if (old && old->key_id == key_id) {
+            old->key_id = NVS_KEY_ID_NONE;      // ID 已经转给新 Key，不能在 remove 时释放
+            nvs_index_remove_hash(slot->key_hash);
+        }
+    }
+
+    slot->key_hash = hash;
+    slot->offset = def_offset;
+}
+
+uint32_t nvs_index_find(const char *key) {
+    uint32_t hash = crc32_compute(key, strlen(key));
+    nvs_index_node_t *node = nvs_index_lookup_hash(hash);
+
+    return node ? node->offset : 0;
+}
+
+nvs_index_node_t *nvs_index_lookup(const char *key) {
+    return nvs_index_lookup_hash(crc32_compute(key, strlen(key)));
+}
+
+// 记录当前值的摘要，nvs_set 用它判断是否是重复写入，nvs_get 用它提前检查缓冲区
+static void index_set_meta(nvs_index_node_t *node, const nvs_entry_header_t *header) {
+    if (node == NULL) return;
+
+    node->key_len = header->key_len;
+    node->data_len = header->data_len;
+    node->crc = header->crc;
+    node->type = header->type;
+}
+
 void nvs_index_clear(void) {
     for (int i = 0; i < NVS_BUCKET_SIZE; i++) {
         buckets[i] = NULL;
     }
     for (int i = 0; i < NVS_MAX_KEYS; i++) {
         g_nvs.node_pool[i].used = 0;
+        g_nvs.key_dict[i].offset = 0;
     }
 }
 
 // --- 3. 挂载 (Mount) - 核心功能 ---
-// 扫描整个扇区，重建 RAM 索引，并返回下一个可写入的地址
+// 扫描整个扇区，重建 RAM 索引和键字典，并返回下一个可写入的地址
 uint32_t nvs_mount(uint32_t sector_addr) {
     nvs_index_clear();
+    g_nvs.wear_record_idx = -1;
 
     uint32_t offset = sizeof(nvs_sector_header_t);
     nvs_entry_header_t header;
-    char key_buf[NVS_KEY_MAX_LEN];
+    char key_buf[NVS_KEY_MAX_LEN + 1];
+    uint8_t temp_data[NVS_DATA_MAX_LEN];
 
     while (offset < NVS_SECTOR_SIZE) {
-        hal_flash_read(sector_addr + offset, &header, sizeof(header));
+        hal_cache_read(sector_addr + offset, &header, sizeof(header));
 
         if (header.state == ENTRY_STATE_EMPTY) {
             break;
@@ -92,25 +199,54 @@ uint32_t nvs_mount(uint32_t sector_addr) {
 
         if (next_offset > NVS_SECTOR_SIZE) break; 
 
-        if (header.state == ENTRY_STATE_VALID) {
-            hal_flash_read(sector_addr + offset + sizeof(header), key_buf, header.key_len);
+        if (header.state == ENTRY_STATE_VALID && header.key_len <= NVS_KEY_MAX_LEN && header.data_len <= NVS_DATA_MAX_LEN) {
+            hal_cache_read(sector_addr + offset + sizeof(header), key_buf, header.key_len);
             key_buf[header.key_len] = '\0';
 
             uint32_t calc_crc = crc32_init();
             calc_crc = crc32_update(calc_crc, key_buf, header.key_len);
 
             // 此时需要读 Data 部分来计算 CRC
-            // 为了节省 RAM，可以分块读，或者如果数据小直接读
-            char temp_data[64]; // 假设最大数据不超过这个，或者用动态 buffer
-            hal_flash_read(sector_addr + offset + sizeof(header) + header.key_len, temp_data, header.data_len);
-            calc_crc = crc32_update(calc_crc, temp_data, header.data_len);
-
-            if (crc32_final(calc_crc) == header.crc) {
-                nvs_index_update(key_buf, offset);
-            } 
-            else {
+            hal_cache_read(sector_addr + offset + sizeof(header) + header.key_len, temp_data, header.data_len);
+            calc_crc = crc32_update(calc_crc, temp_data, NVS_ENTRY_CRC_DATA_LEN(header.type, header.data_len));
+
+            if (crc32_final(calc_crc) != header.crc) {
                 printf("[NVS] Corrupted entry found at offset %d, skipping.\n", offset);
             }
+            else if (header.type == ENTRY_TYPE_KEY_DEF) {
+                uint16_t key_id;
+                memcpy(&key_id, temp_data, sizeof(key_id));
+                dict_mount_def(key_id, key_buf, offset);
+            }
+            else if (header.type == ENTRY_TYPE_WEAR) {
+                // 擦除记录不进索引，GC 也不搬运: 每次跨器件提交都会在新扇区里写一条新的
+                nvs_wear_record_t rec;
+                memcpy(&rec, temp_data, sizeof(rec));
+                if (header.data_len == sizeof(rec) && rec.sector_idx < NVS_SECTOR_COUNT) {
+                    if (g_nvs.sector_erase_counts[rec.sector_idx] < rec.erase_count) {
+                        g_nvs.sector_erase_counts[rec.sector_idx] = rec.erase_count;
+                    }
+                    g_nvs.wear_record_idx = rec.sector_idx;
+                }
+            }
+            else if (header.type == ENTRY_TYPE_DATA_ID) {
+                uint16_t key_id;
+                memcpy(&key_id, key_buf, sizeof(key_id));
+
+                if (key_id < NVS_MAX_KEYS && g_nvs.key_dict[key_id].offset != 0) {
+                    nvs_index_node_t *node = nvs_index_update_hash(g_nvs.key_dict[key_id].key_hash, offset);
+                    if (node) node->key_id = key_id;
+                    index_set_meta(node, &header);
+                }
+                else {
+                    printf("[NVS] Entry at offset %d refers to unknown key id %d, skipping.\n", offset, key_id);
+                }
+            }
+            else {
+                nvs_index_node_t *node = nvs_index_update(key_buf, offset);
+                if (node) node->key_id = NVS_KEY_ID_NONE;
+                index_set_meta(node, &header);
+            }
         }
         offset = next_offset;
     }
@@ -118,6 +254,7 @@ uint32_t nvs_mount(uint32_t sector_addr) {
 }
 
 // [重构] 该函数不再负责擦除扇区，只负责将 RAM 索引指向的数据搬运到目标扇区
+// 字典也在这里压缩: 只有仍被存活 Key 引用的定义条目才会被搬运
 // 返回值: 搬运完成后的新 offset，如果出错返回 0
 uint32_t nvs_index_gc_copy_data(uint32_t src_sector, uint32_t dst_sector) {
     uint32_t current_offset = sizeof(nvs_sector_header_t);
@@ -126,13 +263,20 @@ uint32_t nvs_index_gc_copy_data(uint32_t src_sector, uint32_t dst_sector) {
     char data_buf[NVS_DATA_MAX_LEN];
     nvs_entry_header_t header;
 
+    // 旧字典里的 offset 指向源扇区，搬运过程中逐个改写成目标扇区的 offset
+    nvs_key_dict_t old_dict[NVS_MAX_KEYS];
+    memcpy(old_dict, g_nvs.key_dict, sizeof(old_dict));
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        g_nvs.key_dict[i].offset = 0;
+    }
+
     for (int i = 0; i < NVS_BUCKET_SIZE; i++) {
         nvs_index_node_t *node = buckets[i];
 
         while (node) {
             uint32_t src_addr = src_sector + node->offset;
 
-            hal_flash_read(src_addr, &header, sizeof(header));
+            hal_cache_read(src_addr, &header, sizeof(header));
 
             // 校验数据合法性
             if (header.state != ENTRY_STATE_VALID) {
@@ -140,14 +284,42 @@ uint32_t nvs_index_gc_copy_data(uint32_t src_sector, uint32_t dst_sector) {
                 continue;
             }
             
-            //读key
-            hal_flash_read(src_addr + sizeof(header), key_buf, header.key_len);
-            key_buf[header.key_len] = '\0';
+            //读key (对短 ID 条目来说就是 2 字节 ID)
+            hal_cache_read(src_addr + sizeof(header), key_buf, header.key_len);
             
             //读data
-            hal_flash_read(src_addr + sizeof(header) + header.key_len, data_buf, header.data_len);
+            hal_cache_read(src_addr + sizeof(header) + header.key_len, data_buf, header.data_len);
 
-            int ret_offset = nvs_append_entry(dst_sector, current_offset, key_buf, data_buf, header.data_len);
+            // 短 ID 条目: 先把它的字典定义搬过去，保证挂载时定义总在引用之前
+            if (header.type == ENTRY_TYPE_DATA_ID && node->key_id < NVS_MAX_KEYS) {
+                nvs_entry_header_t def_header;
+                char def_key[NVS_KEY_MAX_LEN];
+                uint32_t def_addr = src_sector + old_dict[node->key_id].offset;
+
+                hal_cache_read(def_addr, &def_header, sizeof(def_header));
+                hal_cache_read(def_addr + sizeof(def_header), def_key, def_header.key_len);
+
+                int def_next = nvs_append_raw(dst_sector, current_offset, ENTRY_TYPE_KEY_DEF, def_key, def_header.key_len, &node->key_id, sizeof(node->key_id));
+                if (def_next <= 0) {
+                    printf("[GC] Error: Destination sector full during copy!\n");
+                    return 0;
+                }
+
+                g_nvs.key_dict[node->key_id].key_hash = old_dict[node->key_id].key_hash;
+                g_nvs.key_dict[node->key_id].offset = current_offset;
+                current_offset = (uint32_t)def_next;
+            }
+
+            int ret_offset;
+            uint32_t counter;
+            if (header.type == ENTRY_TYPE_COUNTER && nvs_counter_value(data_buf, &counter) == 0) {
+                // 计数器搬运时顺便折叠: 当前计数值变成新基数，位图重新全 1
+                // 位图已经损坏的原样搬运，不能折叠成一个看起来合法的新基数
+                ret_offset = nvs_append_counter(dst_sector, current_offset, key_buf, header.key_len, counter);
+            }
+            else {
+                ret_offset = nvs_append_raw(dst_sector, current_offset, header.type, key_buf, header.key_len, data_buf, header.data_len);
+            }
 
             if (ret_offset <= 0) {
                 printf("[GC] Error: Destination sector full during copy!\n");
@@ -165,25 +337,5 @@ uint32_t nvs_index_gc_copy_data(uint32_t src_sector, uint32_t dst_sector) {
 }
 
 void nvs_index_remove(const char *key) {
-    uint32_t hash = crc32_compute(key, strlen(key));
-    uint8_t idx = hash % NVS_BUCKET_SIZE;
-
-    nvs_index_node_t *current = buckets[idx];
-    nvs_index_node_t *prev = NULL;
-
-    while (current) {
-        if (current->key_hash == hash) {
-            if (prev == NULL) {
-                buckets[idx] = current->next;
-            }
-            else {
-                prev->next = current->next;
-            }
-
-            current->used = 0;
-            return;
-        }
-        prev = current;
-        current = current->next;
-    }
+    nvs_index_remove_hash(crc32_compute(key, strlen(key)));
 }
\ No newline at end of file
@@ -1,11 +1,24 @@
 #include <string.h>
-#include "hal_flash.h"
+#include <assert.h>
+#include "hal_flash_cache.h"
 #include "tinynvs.h"
 #include "crc32.h"
 
-int nvs_append_entry(uint32_t sector_addr, uint32_t current_offset, const char *key, const void* data, uint16_t len) {
-    uint8_t key_len = strlen(key);
+// 调试版本里检查句柄的哈希和名字是否一致 (手写 NVS_KEY_CONST 时哈希抄错了能马上发现)
+// 发布版本定义 NDEBUG，*_by_handle 热路径上不再多算一次 CRC
+// 只放在对外的 *_by_handle 入口: 字符串接口的句柄是 nvs_key_init 刚算出来的，直接调内部的 *_value
+#define NVS_KEY_CHECK(key)  assert(crc32_compute((key)->name, (key)->len) == (key)->hash)
+
+// 本文件里的读取都直接走 hal_flash_read: 校验和比较必须看到 Flash 里的真实内容，
+// 读缓存里的旧副本会掩盖缓存之后才发生的位翻转
+static uint32_t entry_crc(const void *key, uint8_t key_len, const void *data, uint16_t len) {
+    uint32_t crc = crc32_init();
+    crc = crc32_update(crc, key, key_len);
+    crc = crc32_update(crc, data, len);
+    return crc32_final(crc);
+}
 
+static int append_with_crc(uint32_t sector_addr, uint32_t current_offset, uint8_t type, const void *key, uint8_t key_len, const void *data, uint16_t len, uint32_t crc) {
     //对齐后的总大小
     uint32_t payload_len = key_len + len;
     uint32_t total_size = sizeof(nvs_entry_header_t) + ALIGN_UP(payload_len, 4);
@@ -16,40 +29,159 @@ int nvs_append_entry(uint32_t sector_addr, uint32_t current_offset, const char *
 
     uint32_t write_addr = sector_addr + current_offset;
 
-    uint32_t check_crc = crc32_init();
-    check_crc = crc32_update(check_crc, key, key_len);
-    check_crc = crc32_update(check_crc, data, len);
-    check_crc = crc32_final(check_crc);
-
     nvs_entry_header_t header;
     header.key_len = key_len;
-    header.type = 0;
+    header.type = type;
     header.data_len = len;
-    header.crc = check_crc;
+    header.crc = crc;
     header.state = ENTRY_STATE_VALID;
 
     uint32_t payload_addr = write_addr + sizeof(header);
 
     // 关键顺序：先写内容，后写头
     // 这样如果写内容时断电，Header 还是 0xFF，下次扫描会忽略这块区域
-    hal_flash_write(payload_addr, key , key_len);
-    hal_flash_write(payload_addr + key_len, data, len);
-    hal_flash_write(write_addr, &header, sizeof(header));
+    hal_cache_write(payload_addr, key , key_len);
+    hal_cache_write(payload_addr + key_len, data, len);
+    hal_cache_write(write_addr, &header, sizeof(header));
 
     return current_offset + total_size;
 }
 
+// 按原样追加一条条目 (计数器的 CRC 同样只覆盖 Key 和基数)
+int nvs_append_raw(uint32_t sector_addr, uint32_t current_offset, uint8_t type, const void *key, uint8_t key_len, const void *data, uint16_t len) {
+    return append_with_crc(sector_addr, current_offset, type, key, key_len, data, len,
+                           entry_crc(key, key_len, data, NVS_ENTRY_CRC_DATA_LEN(type, len)));
+}
+
+// 追加一条计数器条目: 基数 + 全 1 的位图，CRC 只覆盖 Key 和基数
+int nvs_append_counter(uint32_t sector_addr, uint32_t current_offset, const char *key, uint8_t key_len, uint32_t base) {
+    uint8_t payload[NVS_COUNTER_DATA_LEN];
+
+    memcpy(payload, &base, sizeof(base));
+    memset(payload + sizeof(base), 0xFF, NVS_COUNTER_DATA_LEN - sizeof(base));
+
+    return append_with_crc(sector_addr, current_offset, ENTRY_TYPE_COUNTER, key, key_len, payload, NVS_COUNTER_DATA_LEN,
+                           entry_crc(key, key_len, &base, sizeof(base)));
+}
+
+int nvs_append_entry(uint32_t sector_addr, uint32_t current_offset, const char *key, const void* data, uint16_t len) {
+    return nvs_append_raw(sector_addr, current_offset, ENTRY_TYPE_DATA, key, strlen(key), data, len);
+}
+
+// 把一条 Key/Value 写进活动扇区
+// 如果 Key 需要新的字典 ID，会先写定义条目，再写只带 ID 的数据条目
+// 空间不够时两条都不写，返回 -1 交给上层 GC
+// item_offset 返回数据条目的位置，key_id 返回数据条目使用的字典 ID，crc 返回数据条目的 CRC
+static int nvs_write_value(const nvs_key_t *key, const void *data, uint16_t len, uint32_t *item_offset, uint16_t *key_id, uint32_t *crc) {
+    uint8_t key_len = key->len;
+    uint32_t offset = g_nvs.write_offset;
+    nvs_index_node_t *node = nvs_index_lookup_hash(key->hash);
+    uint16_t id = node ? node->key_id : NVS_KEY_ID_NONE;
+    int need_def = 0;
+
+    if (NVS_KEY_DICT_ENABLE && id == NVS_KEY_ID_NONE && key_len > NVS_KEY_DICT_MIN_LEN) {
+        id = nvs_dict_alloc_id();
+        need_def = (id != NVS_KEY_ID_NONE);
+    }
+
+    uint32_t total_size = (id != NVS_KEY_ID_NONE) ? NVS_ENTRY_SIZE(sizeof(id), len) : NVS_ENTRY_SIZE(key_len, len);
+    if (need_def) {
+        total_size += NVS_ENTRY_SIZE(key_len, sizeof(id));
+    }
+    if (offset + total_size > NVS_SECTOR_SIZE) {
+        return -1;
+    }
+
+    if (need_def) {
+        int next = nvs_append_raw(g_nvs.active_sector_addr, offset, ENTRY_TYPE_KEY_DEF, key->name, key_len, &id, sizeof(id));
+        nvs_dict_bind(id, key->hash, offset);
+        offset = (uint32_t)next;
+    }
+
+    *item_offset = offset;
+    *key_id = id;
+
+    if (id != NVS_KEY_ID_NONE) {
+        *crc = entry_crc(&id, sizeof(id), data, len);
+        return append_with_crc(g_nvs.active_sector_addr, offset, ENTRY_TYPE_DATA_ID, &id, sizeof(id), data, len, *crc);
+    }
+    *crc = entry_crc(key->name, key_len, data, len);
+    return append_with_crc(g_nvs.active_sector_addr, offset, ENTRY_TYPE_DATA, key->name, key_len, data, len, *crc);
+}
+
+// 判断新值是否和 Flash 里的当前值相同
+// 先比较 RAM 里缓存的长度和 CRC 摘要，摘要一致再从 Flash 读回数据逐字节确认
+static int nvs_value_unchanged(const nvs_index_node_t *node, const nvs_key_t *key, const void *data, uint16_t len) {
+    if (node == NULL || node->data_len != len) return 0;
+    // 计数器的 CRC 不覆盖位图，摘要比较没有意义
+    if (node->type == ENTRY_TYPE_COUNTER) return 0;
+
+    uint32_t crc;
+    if (node->key_id != NVS_KEY_ID_NONE) {
+        crc = entry_crc(&node->key_id, sizeof(node->key_id), data, len);
+    }
+    else {
+        crc = entry_crc(key->name, key->len, data, len);
+    }
+    if (crc != node->crc) return 0;
+
+    uint32_t addr = g_nvs.active_sector_addr + node->offset + sizeof(nvs_entry_header_t) + node->key_len;
+    const uint8_t *p = (const uint8_t *)data;
+    uint8_t chunk[32];
+
+    for (uint16_t done = 0; done < len; done += sizeof(chunk)) {
+        uint16_t n = (len - done < sizeof(chunk)) ? (len - done) : sizeof(chunk);
+        if (hal_flash_read(addr + done, chunk, n) != 0) return 0;
+        if (memcmp(chunk, p + done, n) != 0) return 0;
+    }
+    return 1;
+}
+
+static int set_value(const nvs_key_t *key, const void *data, uint16_t len) {
+    if (data == NULL || len == 0) return -1;
+    if (key->len > NVS_KEY_MAX_LEN || len > NVS_DATA_MAX_LEN) return -2;
+
+    // 开启了写回的 Key 先缓存在 RAM 里，由 nvs_flush / nvs_poll 批量落盘
+    if (nvs_wb_store(key, data, len)) {
+        return 0;
+    }
+
+    return nvs_set_direct(key, data, len);
+}
+
 int nvs_set(const char *key, const void *data,uint16_t len) {
-    if (key == NULL || data == NULL || len == 0) return -1;
-    if (strlen(key) > NVS_KEY_MAX_LEN) return -2;
+    nvs_key_t handle;
+
+    if (key == NULL) return -1;
+    if (nvs_key_init(&handle, key) != 0) return -2;
+
+    return set_value(&handle, data, len);
+}
+
+int nvs_set_by_handle(const nvs_key_t *key, const void *data, uint16_t len) {
+    if (key == NULL) return -1;
+    NVS_KEY_CHECK(key);
+
+    return set_value(key, data, len);
+}
+
+// 直接写 Flash，不经过写回缓冲 (参数已由调用者检查)
+int nvs_set_direct(const nvs_key_t *key, const void *data, uint16_t len) {
+    // 0. 值没有变化就不写，避免白白消耗 Flash 空间和推进 GC
+    if (nvs_value_unchanged(nvs_index_lookup_hash(key->hash), key, data, len)) {
+        g_nvs.stats.suppressed_writes++;
+        return 0;
+    }
 
-    // 1. 获取写入前的 offset (这就是该数据存放的起始地址)
-    uint32_t item_offset = g_nvs.write_offset;
+    uint32_t item_offset;
+    uint16_t key_id;
+    uint32_t crc;
+    uint32_t start_offset = g_nvs.write_offset;
 
-    // 2. 第一次尝试写入
-    int next_offset = nvs_append_entry(g_nvs.active_sector_addr, item_offset, key, data, len);
+    // 1. 第一次尝试写入
+    int next_offset = nvs_write_value(key, data, len, &item_offset, &key_id, &crc);
 
-    // 3. 如果扇区满了 (返回 -1)，执行 GC
+    // 2. 如果扇区满了 (返回 -1)，执行 GC
     if (next_offset < 0) {
         printf("[NVS] Sector full, triggering GC...\n");
 
@@ -59,11 +191,9 @@ int nvs_set(const char *key, const void *data,uint16_t len) {
             return -3;   //致命错误
         }
 
-        // 获取新的 offset
-        item_offset = g_nvs.write_offset;
-
-        // 4. 第二次尝试写入 (写到新的 active sector)
-        next_offset = nvs_append_entry(g_nvs.active_sector_addr, item_offset, key, data, len);
+        // 3. 第二次尝试写入 (写到新的 active sector)
+        start_offset = g_nvs.write_offset;
+        next_offset = nvs_write_value(key, data, len, &item_offset, &key_id, &crc);
 
         if (next_offset < 0) {
             printf("[NVS] Error: Storage full even after GC!\n");
@@ -71,71 +201,201 @@ int nvs_set(const char *key, const void *data,uint16_t len) {
         }
     }
 
-    // 5. 写入成功，更新 RAM 索引：将 Key 指向刚才写入的 item_offset
-    nvs_index_update(key, item_offset);
+    // 4. 写入成功，更新 RAM 索引：将 Key 指向刚才写入的 item_offset
+    nvs_index_node_t *node = nvs_index_update_hash(key->hash, item_offset);
+    if (node) {
+        node->key_id = key_id;
+        node->key_len = (key_id != NVS_KEY_ID_NONE) ? sizeof(key_id) : key->len;
+        node->type = (key_id != NVS_KEY_ID_NONE) ? ENTRY_TYPE_DATA_ID : ENTRY_TYPE_DATA;
+        node->data_len = len;
+        node->crc = crc;
+    }
 
     // 更新全局写入指针，指向下一个空闲位置
     g_nvs.write_offset = (uint32_t)next_offset;
 
+    g_nvs.stats.write_count++;
+    g_nvs.stats.write_bytes += (uint32_t)next_offset - start_offset;
+
     return 0;
 }
 
-int nvs_get(const char *key, void *buf, uint16_t len) {
-    if (key == NULL || buf == NULL) return -1;
-    
-    // 1. 在 RAM 索引中查找 Key
-    uint32_t offset = nvs_index_find(key);
+// 把一段 Flash 内容分块累加进 CRC，不需要和数据一样大的缓冲区
+static uint32_t crc_update_flash(uint32_t crc, uint32_t addr, uint32_t len) {
+    uint8_t chunk[32];
 
-    if (offset == 0) return -1; // 没找到
+    while (len > 0) {
+        uint32_t n = (len < sizeof(chunk)) ? len : sizeof(chunk);
+        hal_flash_read(addr, chunk, n);
+        crc = crc32_update(crc, chunk, n);
+        addr += n;
+        len -= n;
+    }
+    return crc;
+}
 
-    // 【关键点 1】算出绝对物理地址
-    uint32_t addr = g_nvs.active_sector_addr + offset; 
-    
+// 读出并完整校验一个条目 (头部状态 + Key + Data 的 CRC)
+// buf 不为 NULL 时顺便把数据读进 buf；为 NULL 时只做校验 (后台巡检用)
+// 返回数据长度，校验失败返回 -2，缓冲区不够返回 -3
+static int verify_entry(uint32_t addr, void *buf, uint16_t len) {
     nvs_entry_header_t header;
-
-    // 2. 读取 Entry 头部
-    // 【修正】直接用 addr，不要再加 offset
     hal_flash_read(addr, &header, sizeof(header)); 
 
-    // 3. 校验数据有效性
     if (header.state != ENTRY_STATE_VALID) return -2;
+    if (buf != NULL && len < header.data_len) return -3;
 
-    // 4. 检查用户缓冲区是否够大
-    if (len < header.data_len) {
-        return -3;
-    }
+    // payload 地址紧跟在 header 后面
+    uint32_t payload_addr = addr + sizeof(header); 
+    uint16_t crc_len = NVS_ENTRY_CRC_DATA_LEN(header.type, header.data_len);
 
-    // --- CRC 校验逻辑 ---
     uint32_t calc_crc = crc32_init();
-    
-    // 【修正】payload 地址紧跟在 header 后面
-    uint32_t payload_addr = addr + sizeof(header); 
+    calc_crc = crc_update_flash(calc_crc, payload_addr, header.key_len);
 
-    // 假设你的 Key 最大长度不会爆栈，这里用 256 字节的临时 buffer 是可以的
-    // 但更安全的做法是分段读或者确认 Key 长度限制
-    char key_temp[256]; 
-    if (header.key_len > sizeof(key_temp)) return -4; // 安全检查
+    if (buf != NULL) {
+        hal_flash_read(payload_addr + header.key_len, buf, header.data_len);
+        calc_crc = crc32_update(calc_crc, buf, crc_len);
+    }
+    else {
+        calc_crc = crc_update_flash(calc_crc, payload_addr + header.key_len, crc_len);
+    }
 
-    hal_flash_read(payload_addr, key_temp, header.key_len);
-    calc_crc = crc32_update(calc_crc, key_temp, header.key_len);
+    if (crc32_final(calc_crc) != header.crc) {
+        return -2; // CRC 校验失败
+    }
 
-    hal_flash_read(payload_addr + header.key_len, buf, header.data_len);
-    calc_crc = crc32_update(calc_crc, buf, header.data_len);
+    // 计数器的位图不在 CRC 里，只能检查它的形状
+    if (header.type == ENTRY_TYPE_COUNTER) {
+        uint8_t bitmap[NVS_COUNTER_DATA_LEN];
+        uint32_t value;
 
-    calc_crc = crc32_final(calc_crc);
+        if (header.data_len != NVS_COUNTER_DATA_LEN) return -2;
+        hal_flash_read(payload_addr + header.key_len, bitmap, sizeof(bitmap));
+        if (nvs_counter_value(bitmap, &value) != 0) return -2;
+    }
+    return header.data_len;
+}
 
-    if (calc_crc != header.crc) {
-        return -2; // CRC 校验失败
+static void report_corruption(const nvs_index_node_t *node) {
+    g_nvs.stats.corrupt_count++;
+    printf("[NVS] Corrupted entry detected at offset %d (hash 0x%08X)\n", node->offset, node->key_hash);
+
+    if (g_nvs.corrupt_cb) {
+        g_nvs.corrupt_cb(node->key_hash, node->offset);
+    }
+}
+
+// 按当前策略决定这次读取是否需要完整校验
+static int need_verify(void) {
+    switch (g_nvs.verify_policy) {
+    case NVS_VERIFY_ON_MOUNT:
+        return 0;
+    case NVS_VERIFY_SAMPLED:
+        return (++g_nvs.verify_read_count % NVS_VERIFY_SAMPLE_RATE) == 0;
+    case NVS_VERIFY_ALWAYS:
+    default:
+        return 1;
     }
+}
+
+void nvs_set_verify_policy(nvs_verify_policy_t policy) {
+    g_nvs.verify_policy = policy;
+    g_nvs.verify_read_count = 0;
+}
+
+void nvs_set_corrupt_callback(nvs_corrupt_cb_t cb) {
+    g_nvs.corrupt_cb = cb;
+}
+
+static int get_value(const nvs_key_t *key, void *buf, uint16_t len) {
+    if (buf == NULL) return -1;
+
+    // 写回缓冲里还没落盘的值是最新的
+    int buffered = nvs_wb_load(key, buf, len);
+    if (buffered != 0) return buffered;
     
-    return header.data_len;
+    // 1. 在 RAM 索引中查找 Key
+    nvs_index_node_t *node = nvs_index_lookup_hash(key->hash);
+
+    if (node == NULL || node->offset == 0) return -1; // 没找到
+
+    // 计数器按 32 位计数值返回
+    if (node->type == ENTRY_TYPE_COUNTER) {
+        uint32_t value;
+        if (len < sizeof(value)) return -3;
+
+        int ret = nvs_counter_read(node, &value);
+        if (ret != 0) return ret;
+        memcpy(buf, &value, sizeof(value));
+        return sizeof(value);
+    }
+
+    // 索引里记着值的长度，缓冲区不够大时不用碰 Flash
+    if (len < node->data_len) return -3;
+
+    // 2. 算出绝对物理地址
+    uint32_t addr = g_nvs.active_sector_addr + node->offset; 
+
+    // 3. 信任 RAM 索引: 条目在挂载或写入时已经校验过，跳过头部和 Key 直接读数据
+    if (!need_verify()) {
+        uint32_t data_addr = addr + sizeof(nvs_entry_header_t) + node->key_len;
+        if (hal_flash_read(data_addr, buf, node->data_len) != 0) return -2;
+        return node->data_len;
+    }
+
+    // 4. 完整校验
+    int ret = verify_entry(addr, buf, len);
+    if (ret == -2) {
+        report_corruption(node);
+    }
+    return ret;
 }
 
-int nvs_delete(uint32_t sector_addr, const char *key) {
-    uint32_t offset = nvs_index_find(key);
+int nvs_get(const char *key, void *buf, uint16_t len) {
+    nvs_key_t handle;
+
+    if (nvs_key_init(&handle, key) != 0) return -1;
+
+    return get_value(&handle, buf, len);
+}
+
+int nvs_get_by_handle(const nvs_key_t *key, void *buf, uint16_t len) {
+    if (key == NULL) return -1;
+    NVS_KEY_CHECK(key);
+
+    return get_value(key, buf, len);
+}
+
+// 后台巡检: 从上次停下的位置继续，校验存活条目直到用完 budget_bytes 字节的读取预算
+// 返回本轮发现的损坏条目数，损坏通过回调上报
+int nvs_scrub(uint32_t budget_bytes) {
+    int corrupted = 0;
+    uint32_t spent = 0;
+
+    for (int i = 0; i < NVS_MAX_KEYS && spent < budget_bytes; i++) {
+        nvs_index_node_t *node = &g_nvs.node_pool[g_nvs.scrub_cursor];
+        g_nvs.scrub_cursor = (g_nvs.scrub_cursor + 1) % NVS_MAX_KEYS;
+
+        if (!node->used || node->offset == 0) continue;
+
+        spent += NVS_ENTRY_SIZE(node->key_len, node->data_len);
+
+        if (verify_entry(g_nvs.active_sector_addr + node->offset, NULL, 0) < 0) {
+            report_corruption(node);
+            corrupted++;
+        }
+    }
+    return corrupted;
+}
+
+static int delete_value(uint32_t sector_addr, const nvs_key_t *key) {
+    // 缓冲里未落盘的新值直接丢弃
+    int had_buffered = nvs_wb_drop(key);
+
+    nvs_index_node_t *node = nvs_index_lookup_hash(key->hash);
+    uint32_t offset = node ? node->offset : 0;
 
     if (offset == 0) {
-        return -1;         //根本不存在,没法删
+        return had_buffered ? 0 : -1;         //根本不存在,没法删
     }
 
     uint32_t state_offset_in_header = offsetof(nvs_entry_header_t, state);
@@ -143,12 +403,27 @@ int nvs_delete(uint32_t sector_addr, const char *key) {
 
     nvs_entry_state_t del_state = ENTRY_STATE_DELETED;
 
-    int ret = hal_flash_write(flash_write_addr, &del_state, sizeof(del_state));
+    int ret = hal_cache_write(flash_write_addr, &del_state, sizeof(del_state));
     if (ret != 0) {
         return -2;         //硬件写入失败
     }
 
-    nvs_index_remove(key);
+    nvs_index_remove_hash(key->hash);
 
     return 0;
+}
+
+int nvs_delete(uint32_t sector_addr, const char *key) {
+    nvs_key_t handle;
+
+    if (nvs_key_init(&handle, key) != 0) return -1;
+
+    return delete_value(sector_addr, &handle);
+}
+
+int nvs_delete_by_handle(uint32_t sector_addr, const nvs_key_t *key) {
+    if (key == NULL) return -1;
+    NVS_KEY_CHECK(key);
+
+    return delete_value(sector_addr, key);
 }
\ No newline at end of file
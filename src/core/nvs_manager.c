@@ -1,70 +1,208 @@
 #include <stdio.h>
-#include "hal_flash.h"
+#include <string.h>
+#include "hal_flash_cache.h"
 #include "tinynvs.h"
 
 nvs_manager_t g_nvs = {0};
 
-static int get_sector_idx(uint32_t addr) {
-    return (addr - NVS_BASE_ADDR) / NVS_SECTOR_SIZE;
+// 多片 Flash 时扇区按下标轮流分布到各个器件上:
+// 扇区 i 在器件 i % n 上，是该器件上的第 i / n 个扇区
+// 这样相邻的两个扇区总在不同的器件上，GC 搬运时读写和擦除可以并行
+uint32_t nvs_sector_addr(int idx) {
+    uint32_t devs = g_nvs.device_count ? g_nvs.device_count : 1;
+    return HAL_FLASH_ADDR(idx % devs, NVS_BASE_ADDR + (idx / devs) * NVS_SECTOR_SIZE);
 }
 
-static int is_sector_used(uint32_t sector_addr) {
-    nvs_sector_header_t header;
-    hal_flash_read(sector_addr, &header, sizeof(header));
-    return (header.state == SECTOR_STATE_USED);
+static int get_sector_idx(uint32_t addr) {
+    uint32_t devs = g_nvs.device_count ? g_nvs.device_count : 1;
+    uint32_t row = (HAL_FLASH_ADDR_OFFSET(addr) - NVS_BASE_ADDR) / NVS_SECTOR_SIZE;
+    return row * devs + HAL_FLASH_ADDR_DEV(addr);
 }
 
-static uint32_t nvs_get_best_free_sector(void) {
+// 选择下一个活动扇区: 优先选和当前活动扇区不在同一片 Flash 上的，
+// 这样 GC 是跨器件搬运，旧扇区的擦除也不会挡住新扇区上的写入；
+// 同等条件下选擦除次数最少的 (动态磨损均衡)
+// 静态均衡发现磨损差过大时 (wl_force_min)，暂时放弃跨器件优先，只按擦除次数选，
+// 否则低磨损扇区集中在同一片 Flash 上时，每两次 GC 才轮到它们一次
+static int nvs_get_best_free_sector(uint32_t *sector_addr) {
     uint32_t best_addr = 0;
     uint32_t min_erase_count = 0xFFFFFFFF;
+    int best_same_dev = 1;
     int found = 0;
+    uint32_t active_dev = HAL_FLASH_ADDR_DEV(g_nvs.active_sector_addr);
 
     for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
-        uint32_t current_addr = NVS_BASE_ADDR + (i * NVS_SECTOR_SIZE);
+        uint32_t current_addr = nvs_sector_addr(i);
         
         if (current_addr == g_nvs.active_sector_addr) continue;
 
-        if (g_nvs.sector_erase_counts[i] < min_erase_count) {
+        int same_dev = g_nvs.wl_force_min ? 0 : (HAL_FLASH_ADDR_DEV(current_addr) == active_dev);
+
+        if (same_dev < best_same_dev ||
+            (same_dev == best_same_dev && g_nvs.sector_erase_counts[i] < min_erase_count)) {
             min_erase_count = g_nvs.sector_erase_counts[i];
             best_addr = current_addr;
+            best_same_dev = same_dev;
             found = 1;
         }
     }
 
     if (found) {
         printf("[Manager] Selected Best Free Sector: 0x%08X (EraseCount: %d)\n", best_addr, min_erase_count);
-        return best_addr;
+        *sector_addr = best_addr;
+        return 0;
     }
     
-    return 0;
+    return -1;
 }
 
-int nvs_execute_gc(void) {
-    uint32_t src_sector = g_nvs.active_sector_addr;
-    uint32_t dst_sector = nvs_get_best_free_sector();
+// 擦除后给空闲扇区盖一个头部 (magic + erase_count, state 保持 EMPTY)
+// 否则擦完全是 0xFF，擦除次数只存在 RAM 里，重启后就丢了，磨损均衡也就失效了
+static void stamp_free_sector(uint32_t sector_addr) {
+    nvs_sector_header_t header;
+    header.magic = NVS_SECTOR_MAGIC(g_nvs.device_count);
+    header.erase_count = g_nvs.sector_erase_counts[get_sector_idx(sector_addr)];
+    header.state = SECTOR_STATE_EMPTY;
+    header.seq_id = NVS_FREE_SEQ_ID;
 
-    if (dst_sector == 0) {
-        printf("[GC] Error: No free sector available!\n");
-        return -1;
+    hal_cache_write(sector_addr, &header, sizeof(header));
+}
+
+// 同步擦除一个扇区，计数并盖上空闲头部
+static void release_sector(uint32_t sector_addr) {
+    hal_cache_erase(sector_addr);
+    g_nvs.sector_erase_counts[get_sector_idx(sector_addr)]++;
+    stamp_free_sector(sector_addr);
+}
+
+// GC 提交时旧扇区是异步擦除的，空闲头部要等擦除结束才能写，
+// 所以推迟到空闲时 (nvs_poll) 或下一次需要用空闲扇区时再补上
+void nvs_flush_pending_stamp(void) {
+    if (g_nvs.stamp_pending) {
+        stamp_free_sector(g_nvs.stamp_pending_sector);
+        g_nvs.stamp_pending = 0;
     }
+}
 
-    printf("[GC] Start: 0x%X -> 0x%X\n", src_sector, dst_sector);
+// 整个扇区是否都是 0xFF (擦除是否真的做完了)
+static int is_erased(uint32_t sector_addr) {
+    uint32_t buf[16];
+
+    for (uint32_t offset = 0; offset < NVS_SECTOR_SIZE; offset += sizeof(buf)) {
+        hal_cache_read(sector_addr + offset, buf, sizeof(buf));
+        for (int i = 0; i < 16; i++) {
+            if (buf[i] != 0xFFFFFFFF) return 0;
+        }
+    }
+    return 1;
+}
+
+static int is_stamped_free(uint32_t sector_addr) {
+    nvs_sector_header_t header;
+    hal_cache_read(sector_addr, &header, sizeof(header));
+
+    // magic 里的器件数也要一致，否则覆盖写头部会把 bit 从 0 变 1
+    return header.magic == NVS_SECTOR_MAGIC(g_nvs.device_count) && header.state == SECTOR_STATE_EMPTY && header.seq_id == NVS_FREE_SEQ_ID &&
+           header.erase_count == g_nvs.sector_erase_counts[get_sector_idx(sector_addr)];
+}
+
+static void begin_copy_to(uint32_t dst) {
+    int idx = get_sector_idx(dst);
 
     // 1. 擦除目标扇区 (确保干净)
-    hal_flash_erase(dst_sector);
+    //    盖过空闲头部的扇区在盖章前刚擦过，头部之后全是 0xFF，可以省掉这次擦除
+    if (!is_stamped_free(dst)) {
+        hal_cache_erase(dst);
+        g_nvs.sector_erase_counts[idx]++;
+    }
 
     // 2. 写入头部，状态标记为 COPYING (中间态)
-    //    如果此时掉电，下次 init 会发现这个扇区是 COPYING，说明是垃圾数据
+    //    空闲头部的 state/seq_id 都是 0xFF，直接覆盖写只会把 bit 从 1 变 0
     nvs_sector_header_t new_header;
-    new_header.magic = NVS_MAGIC;
+    new_header.magic = NVS_SECTOR_MAGIC(g_nvs.device_count);
     new_header.seq_id = g_nvs.current_seq_id + 1;
     new_header.state = SECTOR_STATE_COPYING;
-    new_header.erase_count = g_nvs.sector_erase_counts[get_sector_idx(dst_sector)];
+    new_header.erase_count = g_nvs.sector_erase_counts[idx];
+
+    hal_cache_write(dst, &new_header, sizeof(new_header));
+}
 
-    hal_flash_write(dst_sector, &new_header, sizeof(new_header));
+// 准备一个新扇区用来整体重写数据 (GC 和批量导入共用)
+// 选出最佳空闲扇区，擦除后写入 COPYING 状态的头部
+// 如果此时掉电，下次 init 会发现这个扇区是 COPYING，说明是垃圾数据
+int nvs_sector_begin_copy(uint32_t *dst_sector) {
+    uint32_t dst;
 
-    // 3. 搬运数据 (调用 index.c 中的函数)
-    //    这一步会更新 RAM 中的索引指向新地址
+    nvs_flush_pending_stamp();
+
+    if (nvs_get_best_free_sector(&dst) != 0) {
+        printf("[GC] Error: No free sector available!\n");
+        return -1;
+    }
+
+    begin_copy_to(dst);
+
+    *dst_sector = dst;
+    return 0;
+}
+
+// 新扇区写完，提交并切换为活动扇区
+void nvs_sector_commit_copy(uint32_t dst_sector, uint32_t write_offset) {
+    uint32_t src_sector = g_nvs.active_sector_addr;
+    int src_idx = get_sector_idx(src_sector);
+
+    // 旧扇区只启动擦除不等待: 新扇区在另一片 Flash 上时，接下来的写入和擦除并行进行
+    // 同一片 Flash 上反正要等擦除结束才能继续写，直接补上空闲头部；
+    // 跨器件时头部推迟到空闲时 (nvs_poll) 或下一次需要空闲扇区时再写，
+    // 在那之前重启的话擦除次数只能从新扇区里的擦除记录恢复
+    int defer_stamp = HAL_FLASH_ADDR_DEV(src_sector) != HAL_FLASH_ADDR_DEV(dst_sector);
+
+    g_nvs.sector_erase_counts[src_idx]++;
+    if (defer_stamp) {
+        nvs_wear_record_t rec = { src_idx, g_nvs.sector_erase_counts[src_idx] };
+        int next = nvs_append_raw(dst_sector, write_offset, ENTRY_TYPE_WEAR, "", 0, &rec, sizeof(rec));
+        if (next > 0) {
+            write_offset = next;
+        }
+        else {
+            defer_stamp = 0;        // 新扇区写满了，放弃并行，等擦除结束直接盖头部
+        }
+    }
+
+    // 1. 将新扇区标记为 USED (正式生效)
+    //    这个状态切换是原子性的commit点，擦除记录在它之前写入，和提交一起生效
+    nvs_change_sector_state(dst_sector, SECTOR_STATE_USED);
+
+    // 2. 擦除旧扇区
+    //    擦除完成前掉电也没关系，旧扇区的 seq_id 更小，下次 init 会把它当作过期扇区
+    hal_cache_erase_start(src_sector);
+    g_nvs.stamp_pending = 1;
+    g_nvs.stamp_pending_sector = src_sector;
+    if (!defer_stamp) {
+        nvs_flush_pending_stamp();
+    }
+
+    // 3. 更新全局管理器状态
+    g_nvs.active_sector_addr = dst_sector;
+    g_nvs.write_offset = write_offset;
+    g_nvs.current_seq_id++;
+    g_nvs.wl_base_offset = write_offset;
+    g_nvs.wl_cold_checks = 0;
+}
+
+// 放弃写了一半的新扇区，旧的活动扇区保持不变
+void nvs_sector_abort_copy(uint32_t dst_sector) {
+    release_sector(dst_sector);
+}
+
+// 把活动扇区的存活数据搬到已经准备好的 dst_sector
+static int gc_copy_to(uint32_t dst_sector) {
+    uint32_t src_sector = g_nvs.active_sector_addr;
+
+    printf("[GC] Start: 0x%X -> 0x%X\n", src_sector, dst_sector);
+
+    // 搬运数据 (调用 index.c 中的函数)
+    // 这一步会更新 RAM 中的索引指向新地址
     uint32_t new_write_offset = nvs_index_gc_copy_data(src_sector, dst_sector);
 
     if (new_write_offset == 0) {
@@ -73,23 +211,64 @@ int nvs_execute_gc(void) {
         return -2;
     }
 
-    // 4. 搬运成功，将新扇区标记为 USED (正式生效)
-    //    这个状态切换是原子性的commit点
-    nvs_change_sector_state(dst_sector, SECTOR_STATE_USED);
+    nvs_sector_commit_copy(dst_sector, new_write_offset);
+    g_nvs.stats.gc_count++;
+
+    printf("[GC] Done. New Active: 0x%X\n", dst_sector);
+    return 0;
+}
 
-    // 5. 擦除旧扇区
-    hal_flash_erase(src_sector);
-    g_nvs.sector_erase_counts[get_sector_idx(src_sector)]++;
+int nvs_execute_gc(void) {
+    uint32_t dst_sector;
 
-    // 6. 更新全局管理器状态
-    g_nvs.active_sector_addr = dst_sector;
-    g_nvs.write_offset = new_write_offset;
-    g_nvs.current_seq_id++;
+    if (nvs_sector_begin_copy(&dst_sector) != 0) {
+        return -1;
+    }
+    return gc_copy_to(dst_sector);
+}
 
-    printf("[GC] Done. New Active: 0x%X\n", dst_sector);
+// 从扇区头部的 magic 解出写入时的器件数，不是 NVS 扇区返回 0
+static int sector_magic_devices(uint32_t magic) {
+    for (int devs = 1; devs <= HAL_FLASH_MAX_DEVICES; devs++) {
+        if (magic == NVS_SECTOR_MAGIC(devs)) return devs;
+    }
     return 0;
 }
 
+// 器件数改变后 nvs_init 拒绝挂载，应用确认不要旧数据时调用: 按当前布局擦掉所有扇区重新开始
+// 旧布局下其他器件上的扇区不再属于这个存储，保持原样
+int nvs_format_all(void) {
+    g_nvs.device_count = hal_flash_device_count();
+    g_nvs.stamp_pending = 0;
+
+    printf("[NVS] Formatting %d sectors on %d device(s)...\n", NVS_SECTOR_COUNT, g_nvs.device_count);
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        g_nvs.sector_erase_counts[i] = 0;
+        release_sector(nvs_sector_addr(i));
+    }
+    return nvs_init();
+}
+
+// 统计各扇区擦除次数的最大值和最小值，返回磨损最少的扇区下标
+// 同时更新 wl_force_min (擦除次数差超过阈值时 GC 只按擦除次数选目标)
+static int wl_erase_skew(uint32_t *max_count, uint32_t *min_count) {
+    int min_idx = 0;
+
+    *max_count = 0;
+    *min_count = 0xFFFFFFFF;
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        uint32_t cnt = g_nvs.sector_erase_counts[i];
+        if (cnt > *max_count) *max_count = cnt;
+        if (cnt < *min_count) {
+            *min_count = cnt;
+            min_idx = i;
+        }
+    }
+
+    g_nvs.wl_force_min = !g_nvs.wl_static_off && (*max_count - *min_count > NVS_STATIC_WL_THRESHOLD);
+    return min_idx;
+}
+
 int nvs_init(void) {
     nvs_sector_header_t header;
 
@@ -97,15 +276,36 @@ int nvs_init(void) {
     uint32_t max_seq_id = 0;
     int found_candidate = 0;
 
-    printf("[NVS] Init: Scaning %d sectors...\n", NVS_SECTOR_COUNT);
+    // 重启后缓存里的内容不可信 (可能有人绕过缓存直接改过 Flash)
+    hal_cache_invalidate();
+
+    g_nvs.device_count = hal_flash_device_count();
+    g_nvs.stamp_pending = 0;
+    g_nvs.wl_cold_checks = 0;
+    g_nvs.wear_record_idx = -1;
+
+    printf("[NVS] Init: Scaning %d sectors on %d device(s)...\n", NVS_SECTOR_COUNT, g_nvs.device_count);
+
+    // 0. 器件数变了，扇区布局也就变了: 按新布局挂载会读错位置，GC 还会把另一片上的数据丢掉
+    //    在改动 Flash 之前拒绝挂载，由应用决定是否 nvs_format_all() 重新开始
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        hal_cache_read(nvs_sector_addr(i), &header, sizeof(header));
+
+        int devs = sector_magic_devices(header.magic);
+        if (devs > 0 && devs != (int)g_nvs.device_count) {
+            printf("[NVS] Error: store was written striped across %d device(s), now %d. Refusing to mount.\n",
+                   devs, g_nvs.device_count);
+            return -2;
+        }
+    }
 
     // 1. 遍历所有扇区
     for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
-        uint32_t sector_addr = NVS_BASE_ADDR + (i * NVS_SECTOR_SIZE);
+        uint32_t sector_addr = nvs_sector_addr(i);
 
-        hal_flash_read(sector_addr, &header, sizeof(header));
+        hal_cache_read(sector_addr, &header, sizeof(header));
 
-        if (header.magic == NVS_MAGIC) {
+        if (header.magic == NVS_SECTOR_MAGIC(g_nvs.device_count)) {
             g_nvs.sector_erase_counts[i] = header.erase_count;
         }
         else {
@@ -113,12 +313,11 @@ int nvs_init(void) {
         }
 
         // 检查 Magic Number 是否合法
-        if (header.magic != NVS_MAGIC) continue;       
+        if (header.magic != NVS_SECTOR_MAGIC(g_nvs.device_count)) continue;       
         
         if (header.state == SECTOR_STATE_COPYING) {
             printf("  -> Found interrupted GC sector at 0x%08X. Erasing.\n", sector_addr);
-            hal_flash_erase(sector_addr);
-            g_nvs.sector_erase_counts[i]++;
+            release_sector(sector_addr);
             continue;
         }
 
@@ -134,17 +333,14 @@ int nvs_init(void) {
         else {
             if (header.seq_id > max_seq_id) {
                 printf("  -> Found newer sector! Erasing old sector at 0x%08X\n", best_sector_addr);
-                hal_flash_erase(best_sector_addr);
-
-                g_nvs.sector_erase_counts[get_sector_idx(best_sector_addr)]++;
+                release_sector(best_sector_addr);
 
                 best_sector_addr = sector_addr;
                 max_seq_id = header.seq_id;
             }
             else {
                 printf("  -> Found stale sector! Erasing it at 0x%08X\n", sector_addr);
-                hal_flash_erase(sector_addr);
-                g_nvs.sector_erase_counts[i]++;
+                release_sector(sector_addr);
             }
         }
     }
@@ -160,53 +356,118 @@ int nvs_init(void) {
     }
     else {
         printf("[NVS] No active sector. Formatting Sector 0...\n");
-        uint32_t first_sector = NVS_BASE_ADDR;
+        uint32_t first_sector = nvs_sector_addr(0);
 
-        nvs_format_sector(first_sector, 1, 1);
+        nvs_format_sector(first_sector, g_nvs.sector_erase_counts[0], 1);
         nvs_change_sector_state(first_sector, SECTOR_STATE_USED);
 
         g_nvs.active_sector_addr = first_sector;
         g_nvs.write_offset = sizeof(nvs_sector_header_t);
         g_nvs.current_seq_id = 1;
 
-        g_nvs.sector_erase_counts[0] = 1;
+        g_nvs.sector_erase_counts[0]++;
 
         nvs_index_clear();
     }
+
+    // 上次跨器件 GC 之后还没来得及给旧扇区盖空闲头部就重启了: 计数已从擦除记录恢复，
+    // 现在补上头部，下次重启就不再依赖这条记录；擦除被掉电打断的话先重新擦一次
+    if (g_nvs.wear_record_idx >= 0) {
+        uint32_t addr = nvs_sector_addr(g_nvs.wear_record_idx);
+        if (addr != g_nvs.active_sector_addr && !is_stamped_free(addr)) {
+            if (is_erased(addr)) {
+                stamp_free_sector(addr);
+            }
+            else {
+                printf("  -> Sector at 0x%08X was freed by an interrupted erase. Erasing.\n", addr);
+                release_sector(addr);
+            }
+        }
+    }
+    g_nvs.wl_base_offset = g_nvs.write_offset;
+
+    // 擦除次数都存在扇区头部，重启后第一次 GC 就按持久化的磨损差选目标
+    uint32_t max_count, min_count;
+    wl_erase_skew(&max_count, &min_count);
     return 0;
 }
 
-int nvs_check_and_execute_static_wl(void) {
+// 静态磨损均衡
+// 只有活动扇区存数据，每次 GC 擦掉的正是数据所在的扇区，所以要让低磨损扇区多承担擦除，
+// 只能让数据多落在它们上面。每次空闲检查做两件事:
+// 1. 擦除次数差超过阈值时设置 wl_force_min，之后的 GC 只按擦除次数选目标
+//    (不再优先跨器件)，低磨损扇区在同一片 Flash 上时也能连续轮转，直到差值回到阈值以内
+// 2. 磨损最少的正是活动扇区，并且它自挂载或搬入以来一次追加都没有、连续
+//    NVS_STATIC_WL_COLD_CHECKS 次检查都是如此 (确实是冷数据)，就把数据搬到磨损最少的空闲扇区，
+//    擦掉这个低磨损扇区让它回到轮转里。还在被写的扇区迟早会被 GC 换掉，搬了只是多擦一次
+// 擦除次数写在每个扇区的头部 (包括空闲扇区)，所以这个判断在重启后依然成立；
+// 冷数据计数只在 RAM 里，重启后重新计数。
+// budget_bytes 是本次空闲时间允许搬运的字节数，数据量超过预算时推迟到下次。
+// 返回 1 表示执行了一次搬运
+int nvs_static_wl_step(uint32_t budget_bytes) {
+    if (g_nvs.wl_static_off) return 0;
+
     uint32_t max_count = 0;
-    uint32_t min_count = 0xFFFFFFFF;
-    int min_idx = -1;
+    uint32_t min_count = 0;
+    int min_idx = wl_erase_skew(&max_count, &min_count);
+
+    // 有过追加就不是冷数据，直到下一次搬运或重启才重新计数
+    int cold = 0;
+    if (g_nvs.write_offset == g_nvs.wl_base_offset) {
+        cold = (g_nvs.wl_cold_checks >= NVS_STATIC_WL_COLD_CHECKS);
+        if (g_nvs.wl_cold_checks < 0xFF) g_nvs.wl_cold_checks++;
+    }
+    else {
+        g_nvs.wl_cold_checks = 0;
+    }
 
-    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
-        uint32_t cnt = g_nvs.sector_erase_counts[i];
-        if (cnt > max_count) max_count = cnt;
+    uint32_t diff = max_count - min_count;
 
-        uint32_t addr = NVS_BASE_ADDR + i * NVS_SECTOR_SIZE;
+    printf("[WL-Static] Check: Max=%d, Min=%d (Sector %d), Diff=%d\n", max_count, min_count, min_idx, diff);
 
-        if (addr != g_nvs.active_sector_addr && is_sector_used(addr)) {
-            if (cnt < min_count) {
-                min_count = cnt;
-                min_idx = i;
-            }
-        }
+    if (!g_nvs.wl_force_min) return 0;
+
+    // 磨损最少的是空闲扇区时，下一次 GC 自然会用到它
+    if (nvs_sector_addr(min_idx) != g_nvs.active_sector_addr) return 0;
+
+    if (!cold) return 0;
+
+    uint32_t live_bytes = g_nvs.write_offset - sizeof(nvs_sector_header_t);
+    if (live_bytes > budget_bytes) {
+        printf("[WL-Static] Deferred: %d bytes to move, budget %d\n", live_bytes, budget_bytes);
+        return 0;
     }
 
-    if (min_idx == -1) return 0;
+    // 目标和 GC 一样是磨损最少的空闲扇区: 冷数据以后总要被 GC 搬走，
+    // 那时被擦的是它所在的扇区，放在磨损多的扇区上只会让最大值继续上涨
+    uint32_t dst;
+    if (nvs_sector_begin_copy(&dst) != 0) return -1;
 
-    uint32_t diff = (max_count > min_count) ? (max_count - min_count) : 0;
+    printf("[WL-Static] Migrating cold sector %d -> 0x%X\n", min_idx, dst);
+    if (gc_copy_to(dst) != 0) return -1;
 
-    printf("[WL-Static] Check: Max=%d, Min=%d (Sector %d), Diff=%d\n", max_count, min_count, min_idx, diff);
+    g_nvs.stats.wl_migrations++;
+    return 1;
+}
 
-    if (diff > NVS_STATIC_WL_THRESHOLD) {
-        printf("[WL-Static] Threshold exceeded! Forcing GC...\n");
+// 默认开启；关闭后 GC 始终优先跨器件 (搬运延迟最低)，nvs_static_wl_step 什么也不做
+void nvs_set_static_wl(int enable) {
+    uint32_t max_count, min_count;
 
-        if (nvs_execute_gc() == 0) {
-            return 1;
-        }
+    g_nvs.wl_static_off = !enable;
+    wl_erase_skew(&max_count, &min_count);
+}
+
+int nvs_check_and_execute_static_wl(void) {
+    return nvs_static_wl_step(NVS_SECTOR_SIZE);
+}
+
+void nvs_get_stats(nvs_stats_t *stats) {
+    if (stats) {
+        *stats = g_nvs.stats;
     }
-    return 0;
+}
+
+void nvs_reset_stats(void) {
+    memset(&g_nvs.stats, 0, sizeof(g_nvs.stats));
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include <string.h>
+#include <stddef.h>
+#include "hal_flash.h"
+#include "tinynvs.h"
+#include "crc32.h"
+
+// 读出一个存活 Key 的完整名字和数据，并校验条目 CRC
+// 短 ID 条目的 Key 名字从字典定义条目里取
+static int read_live_entry(const nvs_index_node_t *node, nvs_entry_header_t *header, char *key, uint8_t *key_len, uint8_t *data) {
+    uint32_t addr = g_nvs.active_sector_addr + node->offset;
+    uint8_t raw_key[NVS_KEY_MAX_LEN];
+
+    hal_flash_read(addr, header, sizeof(*header));
+    if (header->state != ENTRY_STATE_VALID || header->key_len > NVS_KEY_MAX_LEN || header->data_len > NVS_DATA_MAX_LEN) return -1;
+
+    hal_flash_read(addr + sizeof(*header), raw_key, header->key_len);
+    hal_flash_read(addr + sizeof(*header) + header->key_len, data, header->data_len);
+
+    uint32_t crc = crc32_init();
+    crc = crc32_update(crc, raw_key, header->key_len);
+    crc = crc32_update(crc, data, NVS_ENTRY_CRC_DATA_LEN(header->type, header->data_len));
+    if (crc32_final(crc) != header->crc) return -1;
+
+    if (header->type == ENTRY_TYPE_DATA_ID) {
+        if (node->key_id >= NVS_MAX_KEYS) return -1;
+
+        nvs_entry_header_t def;
+        uint32_t def_addr = g_nvs.active_sector_addr + g_nvs.key_dict[node->key_id].offset;
+
+        hal_flash_read(def_addr, &def, sizeof(def));
+        if (def.state != ENTRY_STATE_VALID || def.type != ENTRY_TYPE_KEY_DEF || def.key_len > NVS_KEY_MAX_LEN) return -1;
+
+        hal_flash_read(def_addr + sizeof(def), key, def.key_len);
+        *key_len = def.key_len;
+    }
+    else {
+        memcpy(key, raw_key, header->key_len);
+        *key_len = header->key_len;
+    }
+    return 0;
+}
+
+// 把所有存活条目按快照格式逐条交给回调，RAM 里同一时刻只有一条记录
+// 返回导出的记录数，出错返回负数
+int nvs_export(nvs_export_cb_t cb, void *ctx) {
+    if (cb == NULL) return -1;
+
+    // 写回缓冲里的最新值先落盘，快照才是完整的
+    if (nvs_flush() != 0) return -2;
+
+    nvs_snapshot_header_t snap;
+    snap.magic = NVS_SNAPSHOT_MAGIC;
+    snap.version = NVS_SNAPSHOT_VERSION;
+    snap.count = 0;
+
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        if (g_nvs.node_pool[i].used && g_nvs.node_pool[i].offset != 0) snap.count++;
+    }
+    snap.crc = crc32_compute(&snap, offsetof(nvs_snapshot_header_t, crc));
+
+    if (cb(&snap, sizeof(snap), ctx) != 0) return -2;
+
+    char key[NVS_KEY_MAX_LEN];
+    uint8_t data[NVS_DATA_MAX_LEN];
+    int exported = 0;
+
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        nvs_index_node_t *node = &g_nvs.node_pool[i];
+        if (!node->used || node->offset == 0) continue;
+
+        nvs_entry_header_t header;
+        nvs_snapshot_record_t rec;
+
+        if (read_live_entry(node, &header, key, &rec.key_len, data) != 0) {
+            printf("[Snapshot] Error: corrupted entry at offset %d, export aborted\n", node->offset);
+            return -3;
+        }
+        rec.type = ENTRY_TYPE_DATA;
+        rec.data_len = header.data_len;
+
+        // 计数器只导出折叠后的 32 位计数值
+        if (header.type == ENTRY_TYPE_COUNTER) {
+            uint32_t value;
+            if (nvs_counter_value(data, &value) != 0) {
+                printf("[Snapshot] Error: corrupted counter at offset %d, export aborted\n", node->offset);
+                return -3;
+            }
+            memcpy(data, &value, sizeof(value));
+            rec.type = ENTRY_TYPE_COUNTER;
+            rec.data_len = sizeof(value);
+        }
+
+        uint32_t crc = crc32_init();
+        crc = crc32_update(crc, &rec, sizeof(rec));
+        crc = crc32_update(crc, key, rec.key_len);
+        crc = crc32_update(crc, data, rec.data_len);
+        crc = crc32_final(crc);
+
+        if (cb(&rec, sizeof(rec), ctx) != 0 ||
+            cb(key, rec.key_len, ctx) != 0 ||
+            cb(data, rec.data_len, ctx) != 0 ||
+            cb(&crc, sizeof(crc), ctx) != 0) {
+            return -2;
+        }
+        exported++;
+    }
+    return exported;
+}
+
+// 从快照流恢复整个存储: 顺序写满一个新扇区，全部校验通过后才提交
+// 中途出错时新扇区被丢弃，原有数据保持不变
+// 返回导入的记录数，出错返回负数
+int nvs_import(nvs_import_cb_t cb, void *ctx) {
+    if (cb == NULL) return -1;
+
+    nvs_snapshot_header_t snap;
+    if (cb(&snap, sizeof(snap), ctx) != 0) return -2;
+
+    if (snap.magic != NVS_SNAPSHOT_MAGIC || snap.version != NVS_SNAPSHOT_VERSION ||
+        snap.crc != crc32_compute(&snap, offsetof(nvs_snapshot_header_t, crc))) {
+        printf("[Snapshot] Error: bad snapshot header\n");
+        return -3;
+    }
+    if (snap.count > NVS_MAX_KEYS) return -4;
+
+    // 与 GC 相同: 先准备一个 COPYING 状态的新扇区
+    uint32_t dst_sector;
+    if (nvs_sector_begin_copy(&dst_sector) != 0) return -5;
+
+    uint32_t offset = sizeof(nvs_sector_header_t);
+    char key[NVS_KEY_MAX_LEN + 1];
+    uint8_t data[NVS_DATA_MAX_LEN];
+    int ret = 0;
+
+    for (uint16_t i = 0; i < snap.count; i++) {
+        nvs_snapshot_record_t rec;
+        uint32_t rec_crc;
+
+        if (cb(&rec, sizeof(rec), ctx) != 0) { ret = -2; break; }
+        if ((rec.type != ENTRY_TYPE_DATA && rec.type != ENTRY_TYPE_COUNTER) || rec.key_len == 0 || rec.key_len > NVS_KEY_MAX_LEN ||
+            rec.data_len == 0 || rec.data_len > NVS_DATA_MAX_LEN ||
+            (rec.type == ENTRY_TYPE_COUNTER && rec.data_len != sizeof(uint32_t))) {
+            ret = -3;
+            break;
+        }
+        if (cb(key, rec.key_len, ctx) != 0 || cb(data, rec.data_len, ctx) != 0 || cb(&rec_crc, sizeof(rec_crc), ctx) != 0) {
+            ret = -2;
+            break;
+        }
+
+        uint32_t crc = crc32_init();
+        crc = crc32_update(crc, &rec, sizeof(rec));
+        crc = crc32_update(crc, key, rec.key_len);
+        crc = crc32_update(crc, data, rec.data_len);
+        if (crc32_final(crc) != rec_crc) {
+            printf("[Snapshot] Error: record %d CRC mismatch\n", i);
+            ret = -3;
+            break;
+        }
+
+        key[rec.key_len] = '\0';
+        int next;
+        if (rec.type == ENTRY_TYPE_COUNTER) {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            next = nvs_append_counter(dst_sector, offset, key, rec.key_len, value);
+        }
+        else {
+            next = nvs_append_entry(dst_sector, offset, key, data, rec.data_len);
+        }
+        if (next < 0) {
+            printf("[Snapshot] Error: snapshot does not fit into one sector\n");
+            ret = -4;
+            break;
+        }
+        offset = (uint32_t)next;
+    }
+
+    if (ret != 0) {
+        nvs_sector_abort_copy(dst_sector);
+        return ret;
+    }
+
+    // 提交新扇区，然后从它重建 RAM 索引；导入前缓存的旧值作废
+    nvs_sector_commit_copy(dst_sector, offset);
+    nvs_wb_discard();
+    g_nvs.write_offset = nvs_mount(dst_sector);
+
+    printf("[Snapshot] Imported %d keys into sector 0x%X\n", snap.count, dst_sector);
+    return snap.count;
+}
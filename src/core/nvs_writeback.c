@@ -0,0 +1,177 @@
+#include <string.h>
+#include "tinynvs.h"
+#include "crc32.h"
+
+static nvs_wb_slot_t *wb_find(uint32_t hash) {
+    for (int i = 0; i < NVS_WB_SLOTS; i++) {
+        if (g_nvs.wb_slots[i].used && g_nvs.wb_slots[i].key_hash == hash) {
+            return &g_nvs.wb_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t wb_dirty_bytes(void) {
+    uint32_t total = 0;
+
+    for (int i = 0; i < NVS_WB_SLOTS; i++) {
+        nvs_wb_slot_t *slot = &g_nvs.wb_slots[i];
+        if (slot->used && slot->dirty) {
+            total += NVS_ENTRY_SIZE(slot->key_len, slot->data_len);
+        }
+    }
+    return total;
+}
+
+static int wb_write_slot(const nvs_wb_slot_t *slot) {
+    nvs_key_t handle = { slot->key, slot->key_hash, slot->key_len };
+    return nvs_set_direct(&handle, slot->data, slot->data_len);
+}
+
+// 把一个 Key 标记为写回模式，max_delay_ms 是允许掉电丢失的最长时间窗口
+int nvs_writeback_enable(const char *key, uint32_t max_delay_ms) {
+    if (key == NULL) return -1;
+
+    size_t len = strlen(key);
+    if (len > NVS_KEY_MAX_LEN) return -1;
+
+    uint32_t hash = crc32_compute(key, len);
+    nvs_wb_slot_t *slot = wb_find(hash);
+    if (slot) {
+        slot->max_delay_ms = max_delay_ms;
+        return 0;
+    }
+
+    for (int i = 0; i < NVS_WB_SLOTS; i++) {
+        slot = &g_nvs.wb_slots[i];
+        if (!slot->used) {
+            memset(slot, 0, sizeof(*slot));
+            memcpy(slot->key, key, len + 1);
+            slot->key_len = (uint8_t)len;
+            slot->key_hash = hash;
+            slot->max_delay_ms = max_delay_ms;
+            slot->used = 1;
+            return 0;
+        }
+    }
+    return -2;      //槽位用完了
+}
+
+// 关闭写回，未落盘的值先写进 Flash
+int nvs_writeback_disable(const char *key) {
+    if (key == NULL) return -1;
+
+    nvs_wb_slot_t *slot = wb_find(crc32_compute(key, strlen(key)));
+    if (slot == NULL) return -1;
+
+    // 落盘失败时槽位保持开启、数据保持脏，调用者可以稍后重试，nvs_poll 也会继续尝试
+    if (slot->dirty) {
+        int ret = wb_write_slot(slot);
+        if (ret != 0) return ret;
+        slot->dirty = 0;
+    }
+    slot->used = 0;
+    return 0;
+}
+
+// nvs_set 的入口: 写回模式的 Key 只更新缓存，返回 1；其他 Key 返回 0 走正常写入
+int nvs_wb_store(const nvs_key_t *key, const void *data, uint16_t len) {
+    nvs_wb_slot_t *slot = wb_find(key->hash);
+    if (slot == NULL) return 0;
+
+    // 从干净变脏时开始计时，之后的更新只覆盖缓存，不推迟期限
+    if (!slot->dirty) {
+        slot->deadline_ms = g_nvs.wb_now_ms + slot->max_delay_ms;
+        slot->dirty = 1;
+    }
+    else {
+        g_nvs.stats.coalesced_writes++;
+    }
+
+    memcpy(slot->data, data, len);
+    slot->data_len = len;
+
+    if (wb_dirty_bytes() >= NVS_WB_FLUSH_BYTES) {
+        nvs_flush();
+    }
+    return 1;
+}
+
+// nvs_get 的入口: 缓存里有未落盘的值时直接返回它，否则返回 0 继续读 Flash
+int nvs_wb_load(const nvs_key_t *key, void *buf, uint16_t len) {
+    nvs_wb_slot_t *slot = wb_find(key->hash);
+    if (slot == NULL || !slot->dirty) return 0;
+
+    if (len < slot->data_len) return -3;
+
+    memcpy(buf, slot->data, slot->data_len);
+    return slot->data_len;
+}
+
+// nvs_delete 的入口: 丢弃未落盘的值，返回是否丢弃了数据
+int nvs_wb_drop(const nvs_key_t *key) {
+    nvs_wb_slot_t *slot = wb_find(key->hash);
+    if (slot == NULL || !slot->dirty) return 0;
+
+    slot->dirty = 0;
+    return 1;
+}
+
+// 丢弃所有未落盘的值 (整体导入快照时使用)
+void nvs_wb_discard(void) {
+    for (int i = 0; i < NVS_WB_SLOTS; i++) {
+        g_nvs.wb_slots[i].dirty = 0;
+    }
+}
+
+// 把所有脏数据作为一批连续追加写进 Flash
+// 空间不够时先做一次 GC，保证这一批不会在中间触发多次 GC
+int nvs_flush(void) {
+    uint32_t need = 0;
+
+    for (int i = 0; i < NVS_WB_SLOTS; i++) {
+        nvs_wb_slot_t *slot = &g_nvs.wb_slots[i];
+        if (slot->used && slot->dirty) {
+            // 最坏情况: 还要写一条字典定义
+            need += NVS_ENTRY_SIZE(slot->key_len, slot->data_len) + NVS_ENTRY_SIZE(slot->key_len, sizeof(uint16_t));
+        }
+    }
+    if (need == 0) return 0;
+
+    if (g_nvs.write_offset + need > NVS_SECTOR_SIZE) {
+        printf("[NVS] Write-back batch needs %d bytes, triggering GC first...\n", need);
+        if (nvs_execute_gc() != 0) return -3;
+    }
+
+    int ret = 0;
+    for (int i = 0; i < NVS_WB_SLOTS; i++) {
+        nvs_wb_slot_t *slot = &g_nvs.wb_slots[i];
+        if (!slot->used || !slot->dirty) continue;
+
+        int r = wb_write_slot(slot);
+        if (r == 0) {
+            slot->dirty = 0;
+        }
+        else {
+            ret = r;
+        }
+    }
+    g_nvs.stats.wb_flushes++;
+    return ret;
+}
+
+// 周期调用 (空闲任务)，推进时间；有任何一个 Key 到期时把所有脏数据一起落盘
+int nvs_poll(uint32_t now_ms) {
+    g_nvs.wb_now_ms = now_ms;
+
+    // 空闲时顺便补上 GC 后延迟的空闲扇区头部
+    nvs_flush_pending_stamp();
+
+    for (int i = 0; i < NVS_WB_SLOTS; i++) {
+        nvs_wb_slot_t *slot = &g_nvs.wb_slots[i];
+        if (slot->used && slot->dirty && (int32_t)(now_ms - slot->deadline_ms) >= 0) {
+            return nvs_flush();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <string.h>
+#include "hal_flash_cache.h"
+
+#define NO_PAGE 0xFFFFFFFF
+
+typedef struct {
+    uint32_t page;                      //页号 = 地址 / FLASH_PAGE_SIZE (含器件号)
+    uint32_t last_use;                  //LRU 时间戳
+    uint8_t valid;
+    uint8_t data[FLASH_PAGE_SIZE];
+} cache_line_t;
+
+static cache_line_t lines[HAL_CACHE_SETS][HAL_CACHE_WAYS];
+static uint8_t burst_buf[HAL_CACHE_MAX_BURST * FLASH_PAGE_SIZE];
+static uint32_t use_clock = 0;
+static uint32_t next_seq_page = NO_PAGE;   //上一次填充之后的下一页，再次从这里未命中说明是顺序扫描
+static int cache_enabled = 1;
+static hal_cache_stats_t stats;
+
+static cache_line_t *lookup(uint32_t page) {
+    cache_line_t *set = lines[page % HAL_CACHE_SETS];
+
+    for (int w = 0; w < HAL_CACHE_WAYS; w++) {
+        if (set[w].valid && set[w].page == page) {
+            set[w].last_use = ++use_clock;
+            return &set[w];
+        }
+    }
+    return NULL;
+}
+
+// 优先用空闲的路，否则替换最久没用的
+static cache_line_t *victim(uint32_t page) {
+    cache_line_t *set = lines[page % HAL_CACHE_SETS];
+    cache_line_t *lru = &set[0];
+
+    for (int w = 0; w < HAL_CACHE_WAYS; w++) {
+        if (!set[w].valid) return &set[w];
+        if (set[w].last_use < lru->last_use) lru = &set[w];
+    }
+    return lru;
+}
+
+// 用一次 HAL 读取把 first_page 开始的 count 页装进缓存
+static int fill(uint32_t first_page, uint32_t count) {
+    uint32_t addr = first_page * FLASH_PAGE_SIZE;
+
+    // 不能越过器件末尾
+    uint32_t pages_left = (FLASH_TOTAL_SIZE - HAL_FLASH_ADDR_OFFSET(addr)) / FLASH_PAGE_SIZE;
+    if (count > pages_left) count = pages_left;
+
+    stats.hal_reads++;
+    stats.hal_read_bytes += count * FLASH_PAGE_SIZE;
+    if (hal_flash_read(addr, burst_buf, count * FLASH_PAGE_SIZE) != 0) return -1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t page = first_page + i;
+        if (lookup(page)) continue;         //预读的页可能已经在缓存里了
+
+        cache_line_t *line = victim(page);
+        line->page = page;
+        line->valid = 1;
+        line->last_use = ++use_clock;
+        memcpy(line->data, burst_buf + i * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+    }
+    next_seq_page = first_page + count;
+    return 0;
+}
+
+int hal_cache_read(uint32_t addr, void *buf, size_t len) {
+    stats.reads++;
+
+    if (!cache_enabled) {
+        stats.hal_reads++;
+        stats.hal_read_bytes += len;
+        return hal_flash_read(addr, buf, len);
+    }
+    if (len == 0) return 0;
+
+    uint8_t *out = (uint8_t *)buf;
+    uint32_t first = addr / FLASH_PAGE_SIZE;
+    uint32_t last = (addr + len - 1) / FLASH_PAGE_SIZE;
+
+    for (uint32_t page = first; page <= last; page++) {
+        cache_line_t *line = lookup(page);
+
+        if (line == NULL) {
+            stats.misses++;
+
+            // 本次请求里连续未命中的页一次读上来
+            uint32_t count = 1;
+            while (page + count <= last && count < HAL_CACHE_MAX_BURST && !lookup(page + count)) {
+                count++;
+            }
+            // 顺序扫描: 接着上次读到的位置继续未命中，多读几页
+            if (page == next_seq_page) {
+                count += HAL_CACHE_READ_AHEAD;
+                if (count > HAL_CACHE_MAX_BURST) count = HAL_CACHE_MAX_BURST;
+            }
+
+            if (fill(page, count) != 0) return -1;
+            line = lookup(page);
+            if (line == NULL) return -1;
+        }
+        else {
+            stats.hits++;
+        }
+
+        uint32_t page_addr = page * FLASH_PAGE_SIZE;
+        uint32_t start = (addr > page_addr) ? addr - page_addr : 0;
+        uint32_t end = (addr + len < page_addr + FLASH_PAGE_SIZE) ? addr + len - page_addr : FLASH_PAGE_SIZE;
+
+        memcpy(out + (page_addr + start - addr), line->data + start, end - start);
+    }
+    return 0;
+}
+
+int hal_cache_write(uint32_t addr, const void *buf, size_t len) {
+    int ret = hal_flash_write(addr, buf, len);
+    if (ret != 0 || len == 0) return ret;
+
+    const uint8_t *in = (const uint8_t *)buf;
+
+    for (int s = 0; s < HAL_CACHE_SETS; s++) {
+        for (int w = 0; w < HAL_CACHE_WAYS; w++) {
+            cache_line_t *line = &lines[s][w];
+            if (!line->valid) continue;
+
+            uint32_t page_addr = line->page * FLASH_PAGE_SIZE;
+            if (page_addr + FLASH_PAGE_SIZE <= addr || page_addr >= addr + len) continue;
+
+            uint32_t start = (addr > page_addr) ? addr - page_addr : 0;
+            uint32_t end = (addr + len < page_addr + FLASH_PAGE_SIZE) ? addr + len - page_addr : FLASH_PAGE_SIZE;
+
+            for (uint32_t i = start; i < end; i++) {
+                line->data[i] &= in[page_addr + i - addr];
+            }
+        }
+    }
+    return 0;
+}
+
+static void invalidate_sector(uint32_t sector_addr) {
+    for (int s = 0; s < HAL_CACHE_SETS; s++) {
+        for (int w = 0; w < HAL_CACHE_WAYS; w++) {
+            uint32_t page_addr = lines[s][w].page * FLASH_PAGE_SIZE;
+            if (page_addr >= sector_addr && page_addr < sector_addr + FLASH_SECTOR_SIZE) {
+                lines[s][w].valid = 0;
+            }
+        }
+    }
+}
+
+int hal_cache_erase(uint32_t sector_addr) {
+    invalidate_sector(sector_addr);
+    return hal_flash_erase(sector_addr);
+}
+
+int hal_cache_erase_start(uint32_t sector_addr) {
+    invalidate_sector(sector_addr);
+    return hal_flash_erase_start(sector_addr);
+}
+
+void hal_cache_invalidate(void) {
+    for (int s = 0; s < HAL_CACHE_SETS; s++) {
+        for (int w = 0; w < HAL_CACHE_WAYS; w++) {
+            lines[s][w].valid = 0;
+        }
+    }
+    next_seq_page = NO_PAGE;
+}
+
+void hal_cache_enable(int enable) {
+    hal_cache_invalidate();
+    cache_enabled = enable;
+}
+
+void hal_cache_get_stats(hal_cache_stats_t *out) {
+    if (out) {
+        *out = stats;
+    }
+}
+
+void hal_cache_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
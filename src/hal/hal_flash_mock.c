@@ -4,14 +4,52 @@
 #include <stdlib.h>
 
 #define FLASH_FILE "flash_mock.bin"
+#define NO_PENDING_ERASE 0xFFFFFFFF
+
+// 每片 Flash 对应一个 bin 文件
+typedef struct {
+    FILE *fp;
+    uint32_t pending_erase;             //正在进行的异步擦除 (器件内扇区地址)
+    uint64_t busy_until_ns;             //异步擦除在虚拟时钟上的结束时间
+    uint32_t erase_counts[FLASH_TOTAL_SIZE / FLASH_SECTOR_SIZE];
+} mock_device_t;
+
+static mock_device_t devices[HAL_FLASH_MAX_DEVICES];
+static int device_count = 0;
+
+// 时序模型 (全 0 表示关闭) 和虚拟时钟
+static hal_flash_timing_t timing;
+static uint64_t now_ns = 0;
+static uint64_t wait_ns = 0;
+static uint32_t jitter_state = 1;
+
+// 线性同余发生器产生抖动，种子固定则每次运行的序列都一样
+static uint64_t apply_jitter(uint64_t ns) {
+    if (timing.jitter_pct == 0) return ns;
+
+    jitter_state = jitter_state * 1103515245u + 12345u;
+    int32_t pct = (int32_t)((jitter_state >> 16) % (2 * timing.jitter_pct + 1)) - (int32_t)timing.jitter_pct;
+    return ns * (uint64_t)(100 + pct) / 100;
+}
+
+static uint64_t read_cost(size_t len) {
+    return timing.read_setup_ns + (uint64_t)timing.read_byte_ns * len;
+}
 
-static FILE *flash_fp = NULL;
+static uint64_t program_cost(uint32_t offset, size_t len) {
+    if (len == 0) return 0;
 
-int hal_flash_init(void) {
-    flash_fp = fopen(FLASH_FILE, "rb+");
-    if (flash_fp == NULL) {
-        flash_fp = fopen(FLASH_FILE, "wb+");
-        if (flash_fp == NULL) {
+    uint32_t pages = (offset + len - 1) / FLASH_PAGE_SIZE - offset / FLASH_PAGE_SIZE + 1;
+    return apply_jitter((uint64_t)timing.program_page_ns * pages);
+}
+
+static int open_device(mock_device_t *dev, const char *path) {
+    memset(dev, 0, sizeof(*dev));
+    dev->pending_erase = NO_PENDING_ERASE;
+    dev->fp = fopen(path, "rb+");
+    if (dev->fp == NULL) {
+        dev->fp = fopen(path, "wb+");
+        if (dev->fp == NULL) {
             printf("[Mock] Error: Unable to create flash.\n");
             return -1;
         }
@@ -19,31 +57,107 @@ int hal_flash_init(void) {
         uint8_t sector_buf[FLASH_SECTOR_SIZE];
         memset(sector_buf, 0xFF, FLASH_SECTOR_SIZE);
         for (int i = 0; i < FLASH_TOTAL_SIZE / FLASH_SECTOR_SIZE; i++) {
-            fwrite(sector_buf, 1, FLASH_SECTOR_SIZE, flash_fp);
+            fwrite(sector_buf, 1, FLASH_SECTOR_SIZE, dev->fp);
         }
         printf("[Mock] Flash created: %d bytes(All 0xFF)\n", FLASH_TOTAL_SIZE);
     }
     return 0;
 }
 
+static void do_erase(mock_device_t *dev, uint32_t offset) {
+    uint8_t sector_buf[FLASH_SECTOR_SIZE];
+    memset(sector_buf, 0xFF, FLASH_SECTOR_SIZE);
+
+    fseek(dev->fp, offset, SEEK_SET);
+    fwrite(sector_buf, 1, FLASH_SECTOR_SIZE, dev->fp);
+    fflush(dev->fp);
+
+    dev->erase_counts[offset / FLASH_SECTOR_SIZE]++;
+}
+
+static int get_device_idx(uint32_t addr, size_t len) {
+    uint32_t dev_idx = HAL_FLASH_ADDR_DEV(addr);
+
+    if (dev_idx >= (uint32_t)device_count) return -1;
+    if (HAL_FLASH_ADDR_OFFSET(addr) + len > FLASH_TOTAL_SIZE) return -1;
+    return (int)dev_idx;
+}
+
+// 器件忙 (有未完成的擦除) 时，访问前先等擦除结束；
+// 开启 erase_suspend 且访问的不是正在擦除的扇区时，暂停擦除先做这次访问
+// 然后虚拟时钟走过这次操作的耗时 op_ns
+static mock_device_t *get_device(uint32_t addr, size_t len, uint64_t op_ns) {
+    int dev_idx = get_device_idx(addr, len);
+    if (dev_idx < 0) return NULL;
+
+    mock_device_t *dev = &devices[dev_idx];
+    uint32_t offset = HAL_FLASH_ADDR_OFFSET(addr);
+
+    if (dev->pending_erase != NO_PENDING_ERASE) {
+        int overlaps = offset < dev->pending_erase + FLASH_SECTOR_SIZE && offset + len > dev->pending_erase;
+
+        if (now_ns >= dev->busy_until_ns || !timing.erase_suspend || overlaps) {
+            hal_flash_sync(dev_idx);
+        }
+        else {
+            // 这次访问和暂停/恢复的开销都顺延到擦除的结束时间上
+            now_ns += timing.suspend_ns;
+            dev->busy_until_ns += timing.suspend_ns + op_ns;
+        }
+    }
+
+    now_ns += op_ns;
+    return dev;
+}
+
+// 初始化器件 0 (flash_mock.bin)，之前添加的其他器件全部关闭
+int hal_flash_init(void) {
+    for (int i = 0; i < device_count; i++) {
+        hal_flash_sync(i);
+        fclose(devices[i].fp);
+    }
+    device_count = 0;
+    now_ns = 0;
+    wait_ns = 0;
+
+    if (open_device(&devices[0], FLASH_FILE) != 0) return -1;
+    device_count = 1;
+    return 0;
+}
+
+// 添加一片 Flash，返回它的器件号
+int hal_flash_add_device(const char *path) {
+    if (device_count >= HAL_FLASH_MAX_DEVICES) return -1;
+    if (open_device(&devices[device_count], path) != 0) return -1;
+
+    return device_count++;
+}
+
+int hal_flash_device_count(void) {
+    return device_count;
+}
+
 int hal_flash_read(uint32_t addr, void *buf, size_t len) {
-    if (addr + len > FLASH_TOTAL_SIZE) return -1;
+    mock_device_t *dev = get_device(addr, len, read_cost(len));
+    if (dev == NULL) return -1;
 
-    fseek(flash_fp, addr, SEEK_SET);
-    size_t read_len = fread(buf, 1, len, flash_fp);
+    fseek(dev->fp, HAL_FLASH_ADDR_OFFSET(addr), SEEK_SET);
+    size_t read_len = fread(buf, 1, len, dev->fp);
     return (read_len == len) ? 0 : -1;
 }
 
 int hal_flash_write(uint32_t addr, const void *buf, size_t len) {
-    if (addr + len > FLASH_TOTAL_SIZE) return -1;
+    mock_device_t *dev = get_device(addr, len, program_cost(HAL_FLASH_ADDR_OFFSET(addr), len));
+    if (dev == NULL) return -1;
 
+    uint32_t offset = HAL_FLASH_ADDR_OFFSET(addr);
     uint8_t *new_data = (uint8_t *)buf;
     uint8_t current_byte;
     int error_flag = 0;
 
     for (size_t i = 0; i < len; i++) {
-        fseek(flash_fp, addr + i, SEEK_SET);
-        fread(&current_byte, 1, 1, flash_fp);
+        fseek(dev->fp, offset + i, SEEK_SET);
+        fread(&current_byte, 1, 1, dev->fp);
 
         uint8_t final_byte = current_byte & new_data[i];
 
@@ -53,28 +167,82 @@ int hal_flash_write(uint32_t addr, const void *buf, size_t len) {
                 error_flag = 1;          
             }
         }
-        fseek(flash_fp, addr + i, SEEK_SET);
-        fwrite (&final_byte, 1, 1, flash_fp);
+        fseek(dev->fp, offset + i, SEEK_SET);
+        fwrite (&final_byte, 1, 1, dev->fp);
     }
-    fflush(flash_fp);
+    fflush(dev->fp);
     return 0;
 }
 
 int hal_flash_erase(uint32_t sector_addr) {
+    if (hal_flash_erase_start(sector_addr) != 0) return -1;
+
+    return hal_flash_sync(HAL_FLASH_ADDR_DEV(sector_addr));
+}
+
+int hal_flash_erase_start(uint32_t sector_addr) {
     if (sector_addr % FLASH_SECTOR_SIZE != 0) {
         printf("[Mock] Error: Erase address 0x%X not aligned to sector size!\n", sector_addr);
         return -1;
     }
 
-    if (sector_addr + FLASH_SECTOR_SIZE > FLASH_TOTAL_SIZE) return -1;
+    int dev_idx = get_device_idx(sector_addr, FLASH_SECTOR_SIZE);
+    if (dev_idx < 0) return -1;
 
-    uint8_t sector_buf[FLASH_SECTOR_SIZE];
-    memset(sector_buf, 0xFF, FLASH_SECTOR_SIZE);
+    // 同一片 Flash 同时只能有一个擦除在进行
+    hal_flash_sync(dev_idx);
+
+    mock_device_t *dev = &devices[dev_idx];
+    dev->pending_erase = HAL_FLASH_ADDR_OFFSET(sector_addr);
+    dev->busy_until_ns = now_ns + apply_jitter(timing.erase_sector_ns);
+    return 0;
+}
+
+// 等待器件上的异步擦除完成
+int hal_flash_sync(int dev_idx) {
+    if (dev_idx < 0 || dev_idx >= device_count) return -1;
+
+    mock_device_t *dev = &devices[dev_idx];
+    if (dev->pending_erase == NO_PENDING_ERASE) return 0;
+
+    // 虚拟时钟还没走到擦除结束，忙等
+    if (dev->busy_until_ns > now_ns) {
+        wait_ns += dev->busy_until_ns - now_ns;
+        now_ns = dev->busy_until_ns;
+    }
 
-    fseek(flash_fp, sector_addr, SEEK_SET);
-    fwrite(sector_buf, 1, FLASH_SECTOR_SIZE, flash_fp);
-    fflush(flash_fp);
+    do_erase(dev, dev->pending_erase);
+    printf("[Mock] Erased sector at 0x%08X\n", HAL_FLASH_ADDR(dev_idx, dev->pending_erase));
 
-    printf("[Mock] Erased sector at 0x%08X\n", sector_addr);
+    dev->pending_erase = NO_PENDING_ERASE;
     return 0;
-}
\ No newline at end of file
+}
+
+uint32_t hal_flash_get_erase_count(uint32_t sector_addr) {
+    uint32_t dev_idx = HAL_FLASH_ADDR_DEV(sector_addr);
+    if (dev_idx >= (uint32_t)device_count) return 0;
+
+    return devices[dev_idx].erase_counts[HAL_FLASH_ADDR_OFFSET(sector_addr) / FLASH_SECTOR_SIZE];
+}
+
+void hal_flash_set_timing(const hal_flash_timing_t *t) {
+    if (t) {
+        timing = *t;
+    }
+    else {
+        memset(&timing, 0, sizeof(timing));
+    }
+    jitter_state = timing.jitter_seed ? timing.jitter_seed : 1;
+}
+
+uint64_t hal_flash_now_ns(void) {
+    return now_ns;
+}
+
+void hal_flash_advance_ns(uint64_t ns) {
+    now_ns += ns;
+}
+
+uint64_t hal_flash_get_wait_ns(void) {
+    return wait_ns;
+}
@@ -0,0 +1,622 @@
+// nvs_image: 离线镜像工具 (运行在主机上)
+//
+//   nvs_image build   <manifest> <image>    根据清单生成可直接烧录的 NVS 镜像
+//   nvs_image inspect <image>               查看镜像: 扇区头、存活/失效比例、损坏条目
+//   nvs_image compact <image> [out_image]   离线 GC: 把活动扇区压缩搬运到新扇区
+//   nvs_image keygen  <manifest> <header>   为清单里的 Key 生成 C 语言句柄常量 (NVS_KEY_CONST)
+//
+// 清单格式 (每行一个 Key，# 开头为注释):
+//   wifi_ssid=MyHomeWiFi        字符串 (不含结尾 '\0')
+//   boot_count:u32=0            32 位小端整数
+//   cal_table:hex=0a0b0c0d      十六进制字节串
+//   boot_count:counter=0        单调计数器的初始值 (配合 nvs_counter_inc)
+//
+// 镜像格式与 flash_mock.bin 相同: FLASH_TOTAL_SIZE 字节，未使用区域为 0xFF
+// 只支持单片 Flash 的布局；多片条带化时每片只有一部分扇区，扇区头里记着器件数，这种镜像直接拒绝
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "tinynvs.h"
+#include "crc32.h"
+
+#define IMG_MAX_RECORDS     256
+
+typedef struct {
+    char key[NVS_KEY_MAX_LEN + 1];
+    uint8_t data[NVS_DATA_MAX_LEN];
+    uint16_t data_len;
+    uint32_t offset;                        //条目在扇区内的偏移 (inspect 用)
+    uint16_t key_id;                        //短 ID 条目使用的字典 ID
+    uint8_t type;                           //ENTRY_TYPE_DATA 或 ENTRY_TYPE_COUNTER (data 为基数 + 位图)
+} img_record_t;
+
+typedef struct {
+    char key[NVS_KEY_MAX_LEN + 1];
+    int bound;
+} img_dict_t;
+
+typedef struct {
+    img_record_t live[IMG_MAX_RECORDS];
+    int live_count;
+    uint32_t entries;
+    uint32_t dead_entries;
+    uint32_t corrupt_entries;
+    uint32_t live_bytes;
+    uint32_t dead_bytes;
+    uint32_t end_offset;
+} img_scan_t;
+
+static uint8_t g_image[FLASH_TOTAL_SIZE];
+
+static uint32_t sector_addr(int i) {
+    return NVS_BASE_ADDR + i * NVS_SECTOR_SIZE;
+}
+
+// 多片条带化的镜像里扇区的位置和单片不同 (见 nvs_sector_addr)，按单片解析会读错
+static int check_layout(const char *path) {
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        nvs_sector_header_t header;
+        memcpy(&header, &g_image[sector_addr(i)], sizeof(header));
+
+        for (int devs = 2; devs <= HAL_FLASH_MAX_DEVICES; devs++) {
+            if (header.magic == NVS_SECTOR_MAGIC(devs)) {
+                printf("[Image] Error: %s is one device of a store striped across %d devices, not supported\n", path, devs);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int load_image(const char *path) {
+    memset(g_image, 0xFF, sizeof(g_image));
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("[Image] Error: cannot open %s\n", path);
+        return -1;
+    }
+    fread(g_image, 1, sizeof(g_image), fp);
+    fclose(fp);
+    return check_layout(path);
+}
+
+static int save_image(const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        printf("[Image] Error: cannot create %s\n", path);
+        return -1;
+    }
+    size_t n = fwrite(g_image, 1, sizeof(g_image), fp);
+    fclose(fp);
+    return (n == sizeof(g_image)) ? 0 : -1;
+}
+
+static void erase_sector(uint32_t addr) {
+    memset(&g_image[addr], 0xFF, NVS_SECTOR_SIZE);
+}
+
+static void write_sector_header(uint32_t addr, uint32_t erase_count, uint32_t state, uint32_t seq_id) {
+    nvs_sector_header_t header;
+    header.magic = NVS_MAGIC;
+    header.erase_count = erase_count;
+    header.state = state;
+    header.seq_id = seq_id;
+    memcpy(&g_image[addr], &header, sizeof(header));
+}
+
+// 计数器的 data 部分: 基数 + 全 1 的位图
+static void counter_payload(uint8_t *data, uint32_t base) {
+    memcpy(data, &base, sizeof(base));
+    memset(data + sizeof(base), 0xFF, NVS_COUNTER_DATA_LEN - sizeof(base));
+}
+
+// 与 nvs_append_entry / nvs_append_counter 相同的布局: Header + Key + Data，按 4 字节对齐
+static int append_entry(uint32_t sector, uint32_t offset, const img_record_t *rec) {
+    uint8_t key_len = strlen(rec->key);
+    uint32_t total_size = NVS_ENTRY_SIZE(key_len, rec->data_len);
+    const uint8_t *data = rec->data;
+    uint8_t folded[NVS_COUNTER_DATA_LEN];
+
+    if (offset + total_size > NVS_SECTOR_SIZE) return -1;
+
+    // 计数器写出时折叠成新基数，位图重新全 1 (扫描时已经剔除了位图损坏的条目)
+    if (rec->type == ENTRY_TYPE_COUNTER) {
+        uint32_t value = 0;
+        nvs_counter_value(rec->data, &value);
+        counter_payload(folded, value);
+        data = folded;
+    }
+
+    uint32_t crc = crc32_init();
+    crc = crc32_update(crc, rec->key, key_len);
+    crc = crc32_update(crc, data, NVS_ENTRY_CRC_DATA_LEN(rec->type, rec->data_len));
+
+    nvs_entry_header_t header;
+    header.key_len = key_len;
+    header.type = rec->type;
+    header.data_len = rec->data_len;
+    header.crc = crc32_final(crc);
+    header.state = ENTRY_STATE_VALID;
+
+    uint8_t *p = &g_image[sector + offset];
+    memcpy(p, &header, sizeof(header));
+    memcpy(p + sizeof(header), rec->key, key_len);
+    memcpy(p + sizeof(header) + key_len, data, rec->data_len);
+
+    return offset + total_size;
+}
+
+// 把一组记录写成一个压缩好的活动扇区，返回写完后的 offset
+static int write_compact_sector(uint32_t addr, uint32_t erase_count, uint32_t seq_id, const img_record_t *recs, int count) {
+    erase_sector(addr);
+    write_sector_header(addr, erase_count, SECTOR_STATE_USED, seq_id);
+
+    int offset = sizeof(nvs_sector_header_t);
+    for (int i = 0; i < count; i++) {
+        offset = append_entry(addr, offset, &recs[i]);
+        if (offset < 0) {
+            printf("[Image] Error: key '%s' does not fit into one sector\n", recs[i].key);
+            return -1;
+        }
+    }
+    return offset;
+}
+
+// --- 扫描 (与 nvs_mount 的语义保持一致) ---
+
+static img_record_t *scan_find(img_scan_t *scan, const char *key) {
+    for (int i = 0; i < scan->live_count; i++) {
+        if (strcmp(scan->live[i].key, key) == 0) return &scan->live[i];
+    }
+    return NULL;
+}
+
+static void scan_remove(img_scan_t *scan, img_record_t *rec) {
+    int idx = rec - scan->live;
+    scan->live[idx] = scan->live[--scan->live_count];
+}
+
+// 一个 Key 有了新条目，旧条目就变成失效数据
+static void scan_put(img_scan_t *scan, const char *key, uint8_t type, const uint8_t *data, uint16_t data_len, uint32_t offset, uint16_t key_id) {
+    img_record_t *rec = scan_find(scan, key);
+
+    if (rec) {
+        uint32_t old_size = NVS_ENTRY_SIZE(rec->key_id != NVS_KEY_ID_NONE ? sizeof(uint16_t) : strlen(rec->key), rec->data_len);
+        scan->live_bytes -= old_size;
+        scan->dead_bytes += old_size;
+        scan->dead_entries++;
+    }
+    else {
+        if (scan->live_count >= IMG_MAX_RECORDS) return;
+        rec = &scan->live[scan->live_count++];
+        strcpy(rec->key, key);
+    }
+
+    memcpy(rec->data, data, data_len);
+    rec->data_len = data_len;
+    rec->offset = offset;
+    rec->key_id = key_id;
+    rec->type = type;
+    scan->live_bytes += NVS_ENTRY_SIZE(key_id != NVS_KEY_ID_NONE ? sizeof(uint16_t) : strlen(key), data_len);
+}
+
+static void scan_sector(uint32_t addr, img_scan_t *scan, int verbose) {
+    static img_dict_t dict[NVS_MAX_KEYS];
+    memset(dict, 0, sizeof(dict));
+    memset(scan, 0, sizeof(*scan));
+
+    uint32_t offset = sizeof(nvs_sector_header_t);
+    nvs_entry_header_t header;
+
+    while (offset < NVS_SECTOR_SIZE) {
+        memcpy(&header, &g_image[addr + offset], sizeof(header));
+        if (header.state == ENTRY_STATE_EMPTY) break;
+
+        uint32_t entry_size = NVS_ENTRY_SIZE(header.key_len, header.data_len);
+        if (offset + entry_size > NVS_SECTOR_SIZE) {
+            if (verbose) printf("    offset %4d: truncated entry, scan stops\n", offset);
+            break;
+        }
+        scan->entries++;
+
+        const uint8_t *key = &g_image[addr + offset + sizeof(header)];
+        const uint8_t *data = key + header.key_len;
+        uint32_t crc = crc32_final(crc32_update(crc32_update(crc32_init(), key, header.key_len), data,
+                                                NVS_ENTRY_CRC_DATA_LEN(header.type, header.data_len)));
+        // 计数器的位图不在 CRC 里，形状不对也算损坏
+        uint32_t counter;
+        int bad_counter = header.type == ENTRY_TYPE_COUNTER &&
+                          (header.data_len != NVS_COUNTER_DATA_LEN || nvs_counter_value(data, &counter) != 0);
+
+        if (header.state != ENTRY_STATE_VALID) {
+            scan->dead_entries++;
+            scan->dead_bytes += entry_size;
+        }
+        else if (crc != header.crc || header.key_len > NVS_KEY_MAX_LEN || header.data_len > NVS_DATA_MAX_LEN) {
+            scan->corrupt_entries++;
+            scan->dead_bytes += entry_size;
+            if (verbose) printf("    offset %4d: CORRUPTED (crc 0x%08X, expected 0x%08X)\n", offset, crc, header.crc);
+        }
+        else if (bad_counter) {
+            scan->corrupt_entries++;
+            scan->dead_bytes += entry_size;
+            if (verbose) printf("    offset %4d: CORRUPTED (counter bitmap not contiguous)\n", offset);
+        }
+        else if (header.type == ENTRY_TYPE_KEY_DEF) {
+            uint16_t key_id;
+            memcpy(&key_id, data, sizeof(key_id));
+            // 字典定义条目算作元数据，不计入存活数据
+            scan->dead_bytes += entry_size;
+            if (key_id < NVS_MAX_KEYS) {
+                // ID 被复用说明之前绑定的 Key 已被删除
+                // 长度也要比较: 只比前缀的话 "wifi" 换成 "wifi_ssid" 会被当成同一个 Key
+                if (dict[key_id].bound &&
+                    (strlen(dict[key_id].key) != header.key_len || memcmp(dict[key_id].key, key, header.key_len) != 0)) {
+                    img_record_t *old = scan_find(scan, dict[key_id].key);
+                    if (old && old->key_id == key_id) scan_remove(scan, old);
+                }
+                memcpy(dict[key_id].key, key, header.key_len);
+                dict[key_id].key[header.key_len] = '\0';
+                dict[key_id].bound = 1;
+            }
+        }
+        else if (header.type == ENTRY_TYPE_WEAR) {
+            // 擦除记录也是元数据 (只在多片 Flash 的存储里出现)
+            scan->dead_bytes += entry_size;
+        }
+        else if (header.type == ENTRY_TYPE_DATA_ID) {
+            uint16_t key_id;
+            memcpy(&key_id, key, sizeof(key_id));
+            if (key_id < NVS_MAX_KEYS && dict[key_id].bound) {
+                scan_put(scan, dict[key_id].key, ENTRY_TYPE_DATA, data, header.data_len, offset, key_id);
+            }
+            else {
+                scan->corrupt_entries++;
+                scan->dead_bytes += entry_size;
+                if (verbose) printf("    offset %4d: unknown key id %d\n", offset, key_id);
+            }
+        }
+        else {
+            char key_buf[NVS_KEY_MAX_LEN + 1];
+            memcpy(key_buf, key, header.key_len);
+            key_buf[header.key_len] = '\0';
+            scan_put(scan, key_buf, header.type, data, header.data_len, offset, NVS_KEY_ID_NONE);
+        }
+        offset += entry_size;
+    }
+    scan->end_offset = offset;
+}
+
+// 找到 seq_id 最大的 USED 扇区，与 nvs_init 的选择规则相同
+static int find_active_sector(void) {
+    int best = -1;
+    uint32_t max_seq = 0;
+
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        nvs_sector_header_t header;
+        memcpy(&header, &g_image[sector_addr(i)], sizeof(header));
+
+        if (header.magic != NVS_MAGIC || header.state != SECTOR_STATE_USED) continue;
+        if (best < 0 || header.seq_id > max_seq) {
+            best = i;
+            max_seq = header.seq_id;
+        }
+    }
+    return best;
+}
+
+// --- build ---
+
+static int parse_hex(const char *s, uint8_t *out, uint16_t *len) {
+    size_t n = strlen(s);
+    if (n % 2 != 0 || n / 2 > NVS_DATA_MAX_LEN) return -1;
+
+    for (size_t i = 0; i < n / 2; i++) {
+        unsigned int byte;
+        if (sscanf(s + i * 2, "%2x", &byte) != 1) return -1;
+        out[i] = (uint8_t)byte;
+    }
+    *len = n / 2;
+    return 0;
+}
+
+static int parse_manifest_line(char *line, img_record_t *rec) {
+    char *eq = strchr(line, '=');
+    if (eq == NULL) return -1;
+    *eq = '\0';
+
+    char *value = eq + 1;
+    char *type = strchr(line, ':');
+    if (type) *type++ = '\0';
+
+    if (strlen(line) == 0 || strlen(line) > NVS_KEY_MAX_LEN) return -1;
+    strcpy(rec->key, line);
+    rec->key_id = NVS_KEY_ID_NONE;
+    rec->type = ENTRY_TYPE_DATA;
+
+    if (type == NULL || strcmp(type, "str") == 0) {
+        size_t n = strlen(value);
+        if (n == 0 || n > NVS_DATA_MAX_LEN) return -1;
+        memcpy(rec->data, value, n);
+        rec->data_len = n;
+    }
+    else if (strcmp(type, "u32") == 0) {
+        uint32_t v = (uint32_t)strtoul(value, NULL, 0);
+        memcpy(rec->data, &v, sizeof(v));
+        rec->data_len = sizeof(v);
+    }
+    else if (strcmp(type, "counter") == 0) {
+        counter_payload(rec->data, (uint32_t)strtoul(value, NULL, 0));
+        rec->data_len = NVS_COUNTER_DATA_LEN;
+        rec->type = ENTRY_TYPE_COUNTER;
+    }
+    else if (strcmp(type, "hex") == 0) {
+        if (parse_hex(value, rec->data, &rec->data_len) != 0 || rec->data_len == 0) return -1;
+    }
+    else {
+        return -1;
+    }
+    return 0;
+}
+
+static int cmd_build(const char *manifest, const char *out) {
+    static img_record_t recs[NVS_MAX_KEYS];
+    int count = 0;
+    int line_no = 0;
+    char line[NVS_KEY_MAX_LEN + NVS_DATA_MAX_LEN * 2 + 16];
+
+    FILE *fp = fopen(manifest, "r");
+    if (fp == NULL) {
+        printf("[Image] Error: cannot open %s\n", manifest);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        img_record_t rec;
+        if (parse_manifest_line(line, &rec) != 0) {
+            printf("[Image] Error: %s:%d: bad manifest line\n", manifest, line_no);
+            fclose(fp);
+            return -1;
+        }
+
+        // 清单里重复的 Key 以最后一次为准
+        int slot = count;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(recs[i].key, rec.key) == 0) slot = i;
+        }
+        if (slot == count) {
+            if (count >= NVS_MAX_KEYS) {
+                printf("[Image] Error: more than %d keys\n", NVS_MAX_KEYS);
+                fclose(fp);
+                return -1;
+            }
+            count++;
+        }
+        recs[slot] = rec;
+    }
+    fclose(fp);
+
+    memset(g_image, 0xFF, sizeof(g_image));
+
+    // 与 nvs_init 首次格式化相同: 扇区 0, erase_count = 1, seq_id = 1
+    int end = write_compact_sector(sector_addr(0), 1, 1, recs, count);
+    if (end < 0) return -1;
+
+    if (save_image(out) != 0) return -1;
+
+    printf("[Image] Built %s: %d keys, %d/%d bytes used in sector 0\n", out, count, end, NVS_SECTOR_SIZE);
+    return 0;
+}
+
+// --- inspect ---
+
+static int cmd_inspect(const char *path) {
+    if (load_image(path) != 0) return -1;
+
+    int active = find_active_sector();
+
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        nvs_sector_header_t header;
+        memcpy(&header, &g_image[sector_addr(i)], sizeof(header));
+
+        printf("Sector %d @ 0x%08X: ", i, sector_addr(i));
+        if (header.magic != NVS_MAGIC) {
+            printf("blank\n");
+            continue;
+        }
+
+        const char *state = (header.state == SECTOR_STATE_USED) ? "USED" :
+                            (header.state == SECTOR_STATE_COPYING) ? "COPYING" :
+                            (header.state == SECTOR_STATE_EMPTY) ? "EMPTY" : "UNKNOWN";
+        if (header.state == SECTOR_STATE_EMPTY && header.seq_id == NVS_FREE_SEQ_ID) {
+            printf("free erase_count=%u\n", header.erase_count);
+            continue;
+        }
+        printf("%s seq=%u erase_count=%u%s\n", state, header.seq_id, header.erase_count, (i == active) ? " [active]" : "");
+
+        if (header.state != SECTOR_STATE_USED) continue;
+
+        static img_scan_t scan;
+        scan_sector(sector_addr(i), &scan, 1);
+
+        uint32_t used = scan.end_offset - sizeof(nvs_sector_header_t);
+        printf("    entries=%u live=%d dead=%u corrupted=%u\n", scan.entries, scan.live_count, scan.dead_entries, scan.corrupt_entries);
+        printf("    live=%u bytes, dead=%u bytes (%.1f%% dead), free=%u bytes\n",
+               scan.live_bytes, scan.dead_bytes, used ? 100.0 * scan.dead_bytes / used : 0.0, NVS_SECTOR_SIZE - scan.end_offset);
+
+        for (int k = 0; k < scan.live_count; k++) {
+            printf("    %-32s len=%-4d offset=%d%s", scan.live[k].key, scan.live[k].data_len, scan.live[k].offset,
+                   scan.live[k].key_id != NVS_KEY_ID_NONE ? " (dict)" : "");
+            uint32_t counter;
+            if (scan.live[k].type == ENTRY_TYPE_COUNTER && nvs_counter_value(scan.live[k].data, &counter) == 0) {
+                printf(" (counter=%u)", counter);
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
+
+// --- compact ---
+
+static int cmd_compact(const char *path, const char *out) {
+    if (load_image(path) != 0) return -1;
+
+    int active = find_active_sector();
+    if (active < 0) {
+        printf("[Image] Error: no active sector in %s\n", path);
+        return -1;
+    }
+
+    nvs_sector_header_t src_header;
+    memcpy(&src_header, &g_image[sector_addr(active)], sizeof(src_header));
+
+    static img_scan_t scan;
+    scan_sector(sector_addr(active), &scan, 0);
+
+    // 目标扇区: 擦除次数最少的非活动扇区 (与 GC 的选择规则相同)
+    int dst = -1;
+    uint32_t dst_count = 0xFFFFFFFF;
+    for (int i = 0; i < NVS_SECTOR_COUNT; i++) {
+        if (i == active) continue;
+
+        nvs_sector_header_t header;
+        memcpy(&header, &g_image[sector_addr(i)], sizeof(header));
+        uint32_t count = (header.magic == NVS_MAGIC) ? header.erase_count : 0;
+
+        if (count < dst_count) {
+            dst_count = count;
+            dst = i;
+        }
+    }
+
+    // 离线压缩时字典条目全部展开为内联 Key
+    for (int i = 0; i < scan.live_count; i++) {
+        scan.live[i].key_id = NVS_KEY_ID_NONE;
+    }
+
+    int end = write_compact_sector(sector_addr(dst), dst_count + 1, src_header.seq_id + 1, scan.live, scan.live_count);
+    if (end < 0) return -1;
+
+    // 旧扇区擦除后盖上空闲头部，保留擦除次数 (与运行时 GC 一致)
+    erase_sector(sector_addr(active));
+    write_sector_header(sector_addr(active), src_header.erase_count + 1, SECTOR_STATE_EMPTY, NVS_FREE_SEQ_ID);
+
+    if (save_image(out) != 0) return -1;
+
+    printf("[Image] Compacted sector %d -> %d: %d keys, %u -> %d bytes used\n",
+           active, dst, scan.live_count, scan.end_offset, end);
+    return 0;
+}
+
+// --- keygen ---
+
+// Key 名字转成宏名: boot_count -> NVS_KEY_BOOT_COUNT
+static void key_macro_name(const char *key, char *out) {
+    out += sprintf(out, "NVS_KEY_");
+    for (; *key; key++) {
+        char c = *key;
+        if (c >= 'a' && c <= 'z') c = c - 'a' + 'A';
+        else if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) c = '_';
+        *out++ = c;
+    }
+    *out = '\0';
+}
+
+// 清单里每个 Key 生成一个常量，值只取 '=' 或 ':' 之前的 Key 名字 (也可以是只写 Key 的列表)
+//   static const nvs_key_t k = NVS_KEY_BOOT_COUNT;
+static int cmd_keygen(const char *manifest, const char *out) {
+    char line[NVS_KEY_MAX_LEN + NVS_DATA_MAX_LEN * 2 + 16];
+    static uint32_t seen[IMG_MAX_RECORDS];
+    int line_no = 0;
+    int count = 0;
+
+    FILE *in = fopen(manifest, "r");
+    if (in == NULL) {
+        printf("[Image] Error: cannot open %s\n", manifest);
+        return -1;
+    }
+    FILE *fp = fopen(out, "w");
+    if (fp == NULL) {
+        printf("[Image] Error: cannot create %s\n", out);
+        fclose(in);
+        return -1;
+    }
+
+    fprintf(fp, "// 由 nvs_image keygen 根据 %s 生成，不要手动修改\n", manifest);
+    fprintf(fp, "#ifndef NVS_KEYS_GENERATED_H\n#define NVS_KEYS_GENERATED_H\n\n");
+    fprintf(fp, "#include \"tinynvs_def.h\"\n\n");
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        line[strcspn(line, "=:")] = '\0';
+        size_t len = strlen(line);
+        if (len == 0 || len > NVS_KEY_MAX_LEN || strchr(line, '"') || strchr(line, '\\')) {
+            printf("[Image] Error: %s:%d: bad key\n", manifest, line_no);
+            fclose(in);
+            fclose(fp);
+            return -1;
+        }
+
+        // 清单里重复的 Key 只生成一次
+        uint32_t hash = crc32_compute(line, len);
+        int dup = 0;
+        for (int i = 0; i < count; i++) {
+            if (seen[i] == hash) dup = 1;
+        }
+        if (dup) continue;
+        if (count >= IMG_MAX_RECORDS) {
+            printf("[Image] Error: more than %d keys\n", IMG_MAX_RECORDS);
+            fclose(in);
+            fclose(fp);
+            return -1;
+        }
+        seen[count++] = hash;
+
+        char macro[NVS_KEY_MAX_LEN + 16];
+        key_macro_name(line, macro);
+        fprintf(fp, "#define %-32s NVS_KEY_CONST(\"%s\", 0x%08Xu)\n", macro, line, hash);
+    }
+
+    fprintf(fp, "\n#endif\n");
+    fclose(in);
+    fclose(fp);
+
+    printf("[Image] Generated %d key handles into %s\n", count, out);
+    return 0;
+}
+
+static void usage(void) {
+    printf("usage:\n");
+    printf("  nvs_image build   <manifest> <image>\n");
+    printf("  nvs_image inspect <image>\n");
+    printf("  nvs_image compact <image> [out_image]\n");
+    printf("  nvs_image keygen  <manifest> <header>\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 4 && strcmp(argv[1], "build") == 0) {
+        return cmd_build(argv[2], argv[3]) == 0 ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "inspect") == 0) {
+        return cmd_inspect(argv[2]) == 0 ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "compact") == 0) {
+        return cmd_compact(argv[2], (argc >= 4) ? argv[3] : argv[2]) == 0 ? 0 : 1;
+    }
+    if (argc >= 4 && strcmp(argv[1], "keygen") == 0) {
+        return cmd_keygen(argv[2], argv[3]) == 0 ? 0 : 1;
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,82 @@
+#!/bin/sh
+# nvs_image 回归测试: build -> inspect -> compact -> inspect -> keygen
+# 用法: nvs_image_test.sh <nvs_image 可执行文件> <manifest> <工作目录>
+
+TOOL=$1
+MANIFEST=$2
+DIR=$3
+FAILS=0
+
+check() {
+    if [ "$1" -eq 0 ]; then
+        echo "[PASS] $2"
+    else
+        echo "[FAIL] $2"
+        FAILS=$((FAILS + 1))
+    fi
+}
+
+# 存活 Key 列表 (名字 + 长度)，压缩前后必须一致
+live_keys() {
+    "$TOOL" inspect "$1" | grep ' len=' | awk '{print $1, $2}' | sort
+}
+
+mkdir -p "$DIR"
+rm -f "$DIR"/*
+
+"$TOOL" build "$MANIFEST" "$DIR/image.bin" > /dev/null
+check $? "Build image from manifest"
+
+"$TOOL" inspect "$DIR/image.bin" > "$DIR/inspect.txt"
+check $? "Inspect built image"
+grep -q 'USED seq=1 erase_count=1 \[active\]' "$DIR/inspect.txt"
+check $? "Sector 0 is the active sector"
+grep -q 'corrupted=0' "$DIR/inspect.txt"
+check $? "No corrupted entries"
+
+EXPECTED=$(grep -v '^#' "$MANIFEST" | grep '=' | sed 's/[:=].*//' | sort -u | wc -l)
+ACTUAL=$(live_keys "$DIR/image.bin" | wc -l)
+[ "$EXPECTED" -eq "$ACTUAL" ]
+check $? "All $EXPECTED manifest keys are live"
+grep -q 'device_name' "$DIR/inspect.txt" && grep 'device_name' "$DIR/inspect.txt" | grep -q 'len=12'
+check $? "Duplicate key keeps the last value"
+grep -q '(counter=0)' "$DIR/inspect.txt"
+check $? "Counter decoded"
+
+live_keys "$DIR/image.bin" > "$DIR/keys_before.txt"
+"$TOOL" compact "$DIR/image.bin" "$DIR/compact.bin" > /dev/null
+check $? "Compact image"
+
+"$TOOL" inspect "$DIR/compact.bin" > "$DIR/inspect_compact.txt"
+grep -q 'Sector 1 @ 0x00001000: USED seq=2 erase_count=1 \[active\]' "$DIR/inspect_compact.txt" &&
+    grep -q 'Sector 0 @ 0x00000000: free erase_count=2' "$DIR/inspect_compact.txt"
+check $? "Compacted data moved to a new sector, old sector stamped free"
+live_keys "$DIR/compact.bin" > "$DIR/keys_after.txt"
+cmp -s "$DIR/keys_before.txt" "$DIR/keys_after.txt"
+check $? "Same live keys after compaction"
+
+"$TOOL" keygen "$MANIFEST" "$DIR/keys.h" > /dev/null
+check $? "Generate key handles"
+[ "$(grep -c 'NVS_KEY_CONST' "$DIR/keys.h")" -eq "$EXPECTED" ]
+check $? "One handle per key"
+
+# 计数器位图不在 CRC 里: 清掉一个不连续的位，inspect 必须报告损坏
+# 位图在条目里的偏移: 头部 12 字节 + Key + 4 字节基数
+OFFSET=$(grep 'boot_count ' "$DIR/inspect.txt" | sed 's/.*offset=\([0-9]*\).*/\1/')
+cp "$DIR/image.bin" "$DIR/bad_counter.bin"
+printf '\375' | dd of="$DIR/bad_counter.bin" bs=1 seek=$((OFFSET + 12 + 10 + 4)) conv=notrunc 2> /dev/null
+"$TOOL" inspect "$DIR/bad_counter.bin" | grep -q 'counter bitmap not contiguous'
+check $? "Counter bitmap with a hole reported as corrupted"
+
+# 多片条带化的镜像: 把扇区头 magic 的最高字节改成 2 片的值 (0x31 ^ 1)，工具必须拒绝
+cp "$DIR/image.bin" "$DIR/striped.bin"
+printf '\060' | dd of="$DIR/striped.bin" bs=1 seek=3 conv=notrunc 2> /dev/null
+"$TOOL" inspect "$DIR/striped.bin" > /dev/null
+[ $? -ne 0 ]
+check $? "Striped multi-device image rejected"
+
+if [ "$FAILS" -ne 0 ]; then
+    echo "$FAILS check(s) failed"
+    exit 1
+fi
+echo "All image tool checks passed."
@@ -0,0 +1,16 @@
+// tinynvs_key.hpp 的编译期检查: make key_check 只做语法检查，不生成目标文件
+// 按头文件声明的最低标准 C++14 编译，确认 constexpr 生成的句柄和 C 端算出的一致
+
+#include "tinynvs_key.hpp"
+
+namespace {
+
+constexpr nvs_key_t kHandleKey = tinynvs::make_key("handle_key");
+
+// 和 main.c 里 NVS_KEY_CONST("handle_key", 0x18613939u) 是同一个值
+static_assert(kHandleKey.hash == 0x18613939u, "make_key hash differs from crc32.c");
+static_assert(kHandleKey.len == 10, "make_key length excludes the terminator");
+static_assert(tinynvs::crc32("", 0) == 0x00000000u, "crc32 of empty input");
+static_assert(tinynvs::crc32("123456789", 9) == 0xCBF43926u, "crc32 check value");
+
+} // namespace